@@ -5,7 +5,7 @@ set -euo pipefail
 CC="gcc"
 
 # header search paths (so plugin_common.h can find consumer_producer.h)
-INC="-I. -Iplugins -Iplugins/sync"
+INC="-I. -Iplugins -Iplugins/sync -Iengine"
 
 CFLAGS="-std=c11 -Wall -Wextra -Werror -O2 -D_POSIX_C_SOURCE=200809L -D_DEFAULT_SOURCE"
 
@@ -27,9 +27,14 @@ log_success() {
 }
 # build main (needs -ldl for dlopen/dlsym)
 log_build "analyzer -> output/analyzer"
-$CC $CFLAGS $INC -o output/analyzer main.c -ldl
+$CC $CFLAGS $INC -o output/analyzer main.c engine/*.c plugins/sync/mem_budget.c plugins/sync/uring.c plugins/sync/varint.c plugins/sync/trace.c plugins/sync/perf_counters.c plugins/sync/log_ring.c -ldl -lpthread
 log_success "Built output/analyzer"
 
+# load generator: standalone, drives the analyzer over a pipe or socket
+log_build "loadgen -> output/loadgen"
+$CC $CFLAGS $INC -o output/loadgen tools/loadgen.c -lpthread
+log_success "Built output/loadgen"
+
 # build plugins: plugins/*.c excluding plugin_common.c and *_test.c
 shopt -s nullglob
 plugins=()
@@ -45,6 +50,9 @@ if ((${#plugins[@]} == 0)); then
   exit 1
 fi
 
+# shared runtime linked into every plugin (queue, monitors, spill segment, output writer, trace)
+SYNC_SRCS=(plugins/sync/*.c)
+
 log_build "Building plugins into output/"
 for src in "${plugins[@]}"; do
   name="${src##*/}"; name="${name%.c}"
@@ -53,8 +61,7 @@ for src in "${plugins[@]}"; do
   $CC -fPIC -shared $CFLAGS $INC -o "$out" \
       "plugins/${name}.c" \
       plugins/plugin_common.c \
-      plugins/sync/monitor.c \
-      plugins/sync/consumer_producer.c \
+      "${SYNC_SRCS[@]}" \
       -ldl -lpthread
   log_success "Built $out"
 done
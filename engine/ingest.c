@@ -0,0 +1,488 @@
+#define _GNU_SOURCE
+#include "ingest.h"
+#include "consumer_producer.h"
+#include "uring.h"
+#include "varint.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SENTINEL_END "<END>"
+#define INGEST_LINE_MAX 1024            // same limit as the fgets path
+#define INGEST_CHUNK (256 * 1024)       // bytes per read request
+#define INGEST_URING_DEPTH 4            // reads in flight on a regular file
+#define INGEST_RECORD_MAX (1u << 30)    // largest varint-framed record accepted
+
+// Splits raw input into records: lines exactly like fgets() into a 1025-byte
+// buffer, or varint length-prefixed records
+typedef struct
+{
+    ingest_framing_t framing;
+    char line[INGEST_LINE_MAX + 1];
+    size_t len;
+    unsigned char header[VARINT_MAX_BYTES]; // length prefix split across reads
+    size_t header_len;
+    char* record;               // record split across reads, NULL if none
+    size_t record_len;
+    size_t record_fill;
+    int done;                   // "<END>" seen
+} framer_t;
+
+typedef struct
+{
+    char* buf;
+    off_t offset;               // file offset of buf[0] (seekable input only)
+    size_t filled;
+    int ready;                  // read complete, buf holds filled bytes
+    int eof;                    // the read hit end of input
+} ingest_slot_t;
+
+static int is_sentinel(const char* data, size_t len)
+{
+    return len == sizeof(SENTINEL_END) - 1 && memcmp(data, SENTINEL_END, len) == 0;
+}
+
+const char* ingest_place_record(const ingest_sink_t* sink, const char* data, size_t len, unsigned flags)
+{
+    // The sentinel always travels whole, however small the chunk size
+    if (sink->place_slice && sink->chunk_size > 0 && len > sink->chunk_size && !is_sentinel(data, len))
+    {
+        // Bounded pieces: no stage has to hold the whole record unless it reassembles it
+        for (size_t off = 0; off < len; off += sink->chunk_size)
+        {
+            size_t n = len - off < sink->chunk_size ? len - off : sink->chunk_size;
+            unsigned chunk = off == 0 ? CP_ITEM_CHUNK_BEGIN
+                           : off + n == len ? CP_ITEM_CHUNK_END : CP_ITEM_CHUNK_CONTINUE;
+            mem_budget_wait(sink->budget, mem_budget_item_size(n));
+            const char* error = sink->place_slice(data + off, n, flags | chunk);
+            if (error) return error;
+        }
+        return NULL;
+    }
+
+    // Hold ingest back while queued bytes exceed the budget
+    mem_budget_wait(sink->budget, mem_budget_item_size(len));
+
+    if (sink->place_slice) return sink->place_slice(data, len, flags);
+
+    char* copy = malloc(len + 1);
+    if (!copy) return "Memory allocation failed";
+    memcpy(copy, data, len);
+    copy[len] = '\0';
+    const char* error = sink->place_work(copy);
+    free(copy);
+    return error;
+}
+
+static const char* framer_emit(framer_t* framer, const ingest_sink_t* sink)
+{
+    framer->line[framer->len] = '\0';
+    size_t len = framer->len;
+    framer->len = 0;
+
+    const char* error;
+    if (sink->chunk_size > 0 && len > sink->chunk_size)
+    {
+        error = ingest_place_record(sink, framer->line, strlen(framer->line), 0);
+    }
+    else
+    {
+        // Hold ingest back while queued bytes exceed the budget
+        mem_budget_wait(sink->budget, mem_budget_item_size(len));
+        error = sink->place_work(framer->line);
+    }
+    if (!error && is_sentinel(framer->line, len)) framer->done = 1;
+    return error;
+}
+
+// Place a complete varint-framed record
+static const char* framer_place_record(framer_t* framer, const ingest_sink_t* sink, const char* data, size_t len)
+{
+    const char* error = ingest_place_record(sink, data, len, 0);
+    if (!error && is_sentinel(data, len)) framer->done = 1;
+    return error;
+}
+
+// Records entirely inside the buffer are placed from it directly; only
+// records split across reads are assembled in framer->record
+static const char* framer_feed_varint(framer_t* framer, const ingest_sink_t* sink, const char* data, size_t n)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    while (n > 0 && !framer->done)
+    {
+        if (!framer->record)
+        {
+            uint64_t len;
+            size_t used;
+            int rc;
+            if (framer->header_len == 0)
+            {
+                rc = varint_decode(p, n, &len, &used);
+                if (rc == 0)
+                {
+                    memcpy(framer->header, p, n);
+                    framer->header_len = n;
+                    return NULL;
+                }
+            }
+            else
+            {
+                // Finish a prefix that started in the previous read
+                framer->header[framer->header_len++] = *p;
+                rc = varint_decode(framer->header, framer->header_len, &len, &used);
+                used = 1;
+                if (rc == 0)
+                {
+                    p++;
+                    n--;
+                    continue;
+                }
+                framer->header_len = 0;
+            }
+            if (rc < 0) return "Malformed record length";
+            if (len > INGEST_RECORD_MAX) return "Record too large";
+            p += used;
+            n -= used;
+
+            if (len <= n)
+            {
+                const char* error = framer_place_record(framer, sink, (const char*)p, (size_t)len);
+                if (error) return error;
+                p += len;
+                n -= (size_t)len;
+                continue;
+            }
+            framer->record = malloc(len + 1);
+            if (!framer->record) return "Memory allocation failed";
+            framer->record_len = (size_t)len;
+            framer->record_fill = 0;
+        }
+
+        size_t take = framer->record_len - framer->record_fill;
+        if (take > n) take = n;
+        memcpy(framer->record + framer->record_fill, p, take);
+        framer->record_fill += take;
+        p += take;
+        n -= take;
+        if (framer->record_fill == framer->record_len)
+        {
+            const char* error = framer_place_record(framer, sink, framer->record, framer->record_len);
+            free(framer->record);
+            framer->record = NULL;
+            if (error) return error;
+        }
+    }
+    return NULL;
+}
+
+static const char* framer_feed(framer_t* framer, const ingest_sink_t* sink, const char* data, size_t n)
+{
+    if (framer->framing == INGEST_FRAMING_VARINT) return framer_feed_varint(framer, sink, data, n);
+
+    while (n > 0 && !framer->done)
+    {
+        size_t room = INGEST_LINE_MAX - framer->len;
+        size_t take = n < room ? n : room;
+        const char* nl = memchr(data, '\n', take);
+        size_t copy = nl ? (size_t)(nl - data) : take;
+
+        memcpy(framer->line + framer->len, data, copy);
+        framer->len += copy;
+        data += copy + (nl ? 1 : 0);
+        n -= copy + (nl ? 1 : 0);
+
+        // A full buffer is emitted as is, like fgets does; the rest follows as the next line
+        if (nl || framer->len == INGEST_LINE_MAX)
+        {
+            const char* error = framer_emit(framer, sink);
+            if (error) return error;
+        }
+    }
+    return NULL;
+}
+
+// Fallback when io_uring is unavailable: large read(2) calls, same framing
+static const char* ingest_fd_read(int fd, framer_t* framer, const ingest_sink_t* sink)
+{
+    char* buf = malloc(INGEST_CHUNK);
+    if (!buf) return "Memory allocation failed";
+
+    const char* error = NULL;
+    while (!error && !framer->done)
+    {
+        ssize_t n = read(fd, buf, INGEST_CHUNK);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) error = "Failed to read input";
+        if (n <= 0) break;
+        error = framer_feed(framer, sink, buf, (size_t)n);
+    }
+    free(buf);
+    return error;
+}
+
+static int slot_submit(uring_t* ring, int fd, ingest_slot_t* slots, int index, int seekable)
+{
+    ingest_slot_t* slot = &slots[index];
+    slot->ready = 0;
+    off_t offset = seekable ? slot->offset + (off_t)slot->filled : -1;
+    if (uring_prep_read(ring, fd, slot->buf + slot->filled, INGEST_CHUNK - (unsigned)slot->filled, offset,
+                        (uint64_t)index) != 0)
+    {
+        return -1;
+    }
+    return uring_submit(ring) == 0 ? 0 : -1;
+}
+
+// Keep several large reads in flight while earlier chunks are framed and queued.
+// Regular files use explicit offsets so reads can overlap; anything else (pipes,
+// terminals) has a single read in flight at the current position.
+static const char* ingest_fd_uring(uring_t* ring, int fd, framer_t* framer, const ingest_sink_t* sink)
+{
+    struct stat st;
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    int seekable = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && pos >= 0;
+    int depth = seekable ? INGEST_URING_DEPTH : 1;
+
+    ingest_slot_t slots[INGEST_URING_DEPTH];
+    memset(slots, 0, sizeof(slots));
+    const char* error = NULL;
+    for (int i = 0; i < depth && !error; i++)
+    {
+        slots[i].buf = malloc(INGEST_CHUNK);
+        slots[i].offset = pos;
+        pos += INGEST_CHUNK;
+        if (!slots[i].buf) error = "Memory allocation failed";
+        else if (slot_submit(ring, fd, slots, i, seekable) != 0) error = "Failed to submit read";
+    }
+
+    int head = 0;
+    while (!error && !framer->done)
+    {
+        // Reads complete in any order; consume them in file order
+        while (!error && !slots[head].ready)
+        {
+            uint64_t tag;
+            int res;
+            if (uring_reap(ring, 1, &tag, &res) != 1)
+            {
+                error = "Failed to wait for read";
+                break;
+            }
+            ingest_slot_t* slot = &slots[tag];
+            if (res == -EINTR || res == -EAGAIN)
+            {
+                if (slot_submit(ring, fd, slots, (int)tag, seekable) != 0) error = "Failed to submit read";
+            }
+            else if (res < 0)
+            {
+                error = "Failed to read input";
+            }
+            else
+            {
+                slot->filled += (size_t)res;
+                slot->eof = res == 0;
+                // A short read on a file is finished by reading the remainder (or hitting EOF)
+                if (seekable && res > 0 && slot->filled < INGEST_CHUNK)
+                {
+                    if (slot_submit(ring, fd, slots, (int)tag, seekable) != 0) error = "Failed to submit read";
+                }
+                else
+                {
+                    slot->ready = 1;
+                }
+            }
+        }
+        if (error) break;
+
+        ingest_slot_t* slot = &slots[head];
+        error = framer_feed(framer, sink, slot->buf, slot->filled);
+        if (error || slot->eof || framer->done) break;
+
+        // Reuse the buffer for the next chunk past everything already requested
+        slot->offset = pos;
+        slot->filled = 0;
+        pos += INGEST_CHUNK;
+        if (slot_submit(ring, fd, slots, head, seekable) != 0) error = "Failed to submit read";
+        head = (head + 1) % depth;
+    }
+
+    // The kernel may still write into our buffers: drain before freeing them
+    while (uring_reap(ring, 1, NULL, NULL) == 1)
+        ;
+    for (int i = 0; i < depth; i++) free(slots[i].buf);
+    return error;
+}
+
+static const char* ingest_fd(int fd, const ingest_sink_t* sink, ingest_io_t io, ingest_framing_t framing)
+{
+    framer_t framer;
+    memset(&framer, 0, sizeof(framer));
+    framer.framing = framing;
+
+    uring_t ring;
+    const char* error;
+    if (io == INGEST_IO_URING && uring_init(&ring, INGEST_URING_DEPTH) == 0)
+    {
+        error = ingest_fd_uring(&ring, fd, &framer, sink);
+        uring_destroy(&ring);
+    }
+    else
+    {
+        if (io == INGEST_IO_URING) fprintf(stderr, "Warning: io_uring unavailable, reading input with read()\n");
+        error = ingest_fd_read(fd, &framer, sink);
+    }
+
+    if (framing == INGEST_FRAMING_VARINT)
+    {
+        int truncated = framer.record || framer.header_len > 0;
+        free(framer.record);
+        if (!error && truncated) error = "Truncated record at end of input";
+        // A framed stream ends at end of input
+        if (!framer.done)
+        {
+            const char* end_error = sink->place_work(SENTINEL_END);
+            if (!error) error = end_error;
+        }
+        return error;
+    }
+    // Trailing text without a newline is still a line
+    if (!error && !framer.done && framer.len > 0) error = framer_emit(&framer, sink);
+    return error;
+}
+
+const char* ingest_stdin(const ingest_sink_t* sink, ingest_io_t io, ingest_framing_t framing)
+{
+    // fgets only understands lines; framed input always goes through the chunked path
+    if (io == INGEST_IO_URING || framing == INGEST_FRAMING_VARINT) return ingest_fd(STDIN_FILENO, sink, io, framing);
+
+    char line[1025]; // 1024 chars + null terminator
+    while (fgets(line, sizeof(line), stdin))
+    {
+        // Remove trailing newline
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] == '\n') line[--len] = '\0';
+
+        const char* error;
+        if (sink->chunk_size > 0 && len > sink->chunk_size)
+        {
+            error = ingest_place_record(sink, line, strlen(line), 0);
+        }
+        else
+        {
+            // Hold ingest back while queued bytes exceed the budget
+            mem_budget_wait(sink->budget, mem_budget_item_size(len));
+
+            // Send to first plugin
+            error = sink->place_work(line);
+        }
+        if (error) return error;
+
+        // Check for END signal and exit loop
+        if (is_sentinel(line, len)) break;
+    }
+    return NULL;
+}
+
+const char* ingest_file_open(ingest_file_t* file, const char* path)
+{
+    if (!file || !path) return "Invalid parameters";
+    file->map = NULL;
+    file->size = 0;
+
+    file->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (file->fd < 0) return "Failed to open input file";
+
+    struct stat st;
+    if (fstat(file->fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        ingest_file_close(file);
+        return "Input is not a regular file";
+    }
+    file->size = (size_t)st.st_size;
+    if (file->size == 0) return NULL; // nothing to map, feed only sends "<END>"
+
+    void* map = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, file->fd, 0);
+    if (map == MAP_FAILED)
+    {
+        ingest_file_close(file);
+        return "Failed to map input file";
+    }
+    // One front-to-back pass: aggressive readahead, pages can go once read
+    madvise(map, file->size, MADV_SEQUENTIAL);
+    file->map = map;
+    return NULL;
+}
+
+// Varint-framed file: every record is a borrowed slice of the mapping
+static const char* file_feed_varint(ingest_file_t* file, const ingest_sink_t* sink, int* ended)
+{
+    const unsigned char* pos = (const unsigned char*)file->map;
+    const unsigned char* end = file->map ? pos + file->size : NULL;
+    while (pos < end)
+    {
+        uint64_t len;
+        size_t used;
+        int rc = varint_decode(pos, (size_t)(end - pos), &len, &used);
+        if (rc < 0) return "Malformed record length";
+        if (rc == 0 || len > (uint64_t)(end - pos) - used) return "Truncated record at end of input";
+        pos += used;
+
+        const char* data = (const char*)pos;
+        *ended = is_sentinel(data, (size_t)len);
+        const char* error = *ended ? sink->place_work(SENTINEL_END)
+                                   : ingest_place_record(sink, data, (size_t)len, CP_ITEM_BORROWED);
+        if (error || *ended) return error;
+        pos += len;
+    }
+    return NULL;
+}
+
+static const char* file_feed_lines(ingest_file_t* file, const ingest_sink_t* sink, int* ended)
+{
+    const char* pos = file->map;
+    const char* end = file->map ? file->map + file->size : NULL;
+    while (pos < end)
+    {
+        const char* nl = memchr(pos, '\n', (size_t)(end - pos));
+        size_t len = nl ? (size_t)(nl - pos) : (size_t)(end - pos);
+
+        *ended = is_sentinel(pos, len);
+        const char* error = *ended ? sink->place_work(SENTINEL_END)
+                                   : ingest_place_record(sink, pos, len, CP_ITEM_BORROWED);
+        if (error || *ended) return error;
+
+        pos = nl ? nl + 1 : end;
+    }
+    return NULL;
+}
+
+const char* ingest_file_feed(ingest_file_t* file, const ingest_sink_t* sink, ingest_framing_t framing)
+{
+    if (!file || !sink || !sink->place_work) return "Invalid parameters";
+
+    int ended = 0;
+    const char* error = framing == INGEST_FRAMING_VARINT ? file_feed_varint(file, sink, &ended)
+                                                         : file_feed_lines(file, sink, &ended);
+    // The pipeline always ends, even on a malformed file
+    if (!ended)
+    {
+        const char* end_error = sink->place_work(SENTINEL_END);
+        if (!error) error = end_error;
+    }
+    return error;
+}
+
+void ingest_file_close(ingest_file_t* file)
+{
+    if (!file) return;
+    if (file->map) munmap((void*)file->map, file->size);
+    if (file->fd >= 0) close(file->fd);
+    file->map = NULL;
+    file->size = 0;
+    file->fd = -1;
+}
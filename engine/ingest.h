@@ -0,0 +1,99 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stddef.h>
+#include "mem_budget.h"
+
+/**
+ * How stdin is read
+ */
+typedef enum
+{
+    INGEST_IO_SYNC = 0,     /* fgets, one line at a time (default) */
+    INGEST_IO_URING         /* Large reads kept in flight with io_uring, read(2) if unavailable */
+} ingest_io_t;
+
+/**
+ * How input bytes are split into records
+ */
+typedef enum
+{
+    INGEST_FRAMING_LINES = 0,   /* Newline-terminated text */
+    INGEST_FRAMING_VARINT       /* Unsigned LEB128 length, then that many payload bytes */
+} ingest_framing_t;
+
+/**
+ * Where ingest delivers records: the first stage's entry points plus the
+ * shared byte budget that throttles ingest (NULL when unlimited).
+ */
+typedef struct
+{
+    const char* (*place_work)(const char*);                     /* Required */
+    const char* (*place_slice)(const char*, size_t, unsigned);  /* Optional, NULL if not exported */
+    mem_budget_t* budget;                                       /* Optional */
+    int (*queue_space)(void);                                   /* Optional, free slots in the first queue */
+    size_t chunk_size;                                          /* Split longer records into chunks, 0 = never */
+} ingest_sink_t;
+
+/**
+ * Read-only mapping of an input file. Records handed to the pipeline point
+ * straight into the mapping, so it must stay mapped until every stage has
+ * finished (ingest_file_close after wait_finished).
+ */
+typedef struct
+{
+    int fd;                 /* Input file descriptor, -1 when closed */
+    const char* map;        /* Private read-only mapping, NULL for an empty file */
+    size_t size;            /* File size in bytes */
+} ingest_file_t;
+
+/**
+ * Deliver one record to the first stage, waiting for budget room. Records
+ * longer than sink->chunk_size go out as a BEGIN/CONTINUE/END chunk sequence.
+ * Copies the record only if the first stage lacks place_slice.  
+ * @param sink  Destination  
+ * @param data  Record bytes  
+ * @param len  Number of bytes  
+ * @param flags  CP_ITEM_BORROWED if data outlives the pipeline, else 0  
+ * @return  NULL on success, error message on failure  
+ */
+const char* ingest_place_record(const ingest_sink_t* sink, const char* data, size_t len, unsigned flags);
+
+/**
+ * Read records from stdin until "<END>" or end of input. Lines are split
+ * at 1024 bytes like fgets in every I/O mode. Varint-framed records may hold
+ * any bytes, including newlines and NULs; for them end of input also ends
+ * the pipeline.  
+ * @param sink  Destination of the records  
+ * @param io  I/O mode  
+ * @param framing  Input format  
+ * @return  NULL on success, error message on failure  
+ */
+const char* ingest_stdin(const ingest_sink_t* sink, ingest_io_t io, ingest_framing_t framing);
+
+/**
+ * Open and map an input file for sequential access  
+ * @param file  Pointer to file structure  
+ * @param path  Path of the input file  
+ * @return  NULL on success, error message on failure  
+ */
+const char* ingest_file_open(ingest_file_t* file, const char* path);
+
+/**
+ * Feed every record of the mapped file to the pipeline, then "<END>" if the
+ * file did not contain it. Records are passed as borrowed slices without
+ * copying when the sink supports place_slice.  
+ * @param file  Pointer to an opened file structure  
+ * @param sink  Destination of the records  
+ * @param framing  File format  
+ * @return  NULL on success, error message on failure  
+ */
+const char* ingest_file_feed(ingest_file_t* file, const ingest_sink_t* sink, ingest_framing_t framing);
+
+/**
+ * Unmap and close the input file  
+ * @param file  Pointer to file structure  
+ */
+void ingest_file_close(ingest_file_t* file);
+
+#endif // INGEST_H
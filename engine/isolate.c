@@ -0,0 +1,252 @@
+#define _GNU_SOURCE
+#include "isolate.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define ISOLATE_POLL_MS 1           // readiness poll interval during startup
+
+extern char** environ;
+
+static pid_t spawn_group(isolate_t* iso, int g)
+{
+    // Workers never read stdin; ingest owns it
+    posix_spawn_file_actions_t actions;
+    if (posix_spawn_file_actions_init(&actions) != 0) return -1;
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+
+    iso->argv[2] = iso->worker_specs[g];
+    pid_t pid;
+    int rc = posix_spawn(&pid, "/proc/self/exe", &actions, NULL, iso->argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    return rc == 0 ? pid : -1;
+}
+
+static void describe_status(int status, char* buf, size_t size)
+{
+    if (WIFSIGNALED(status)) snprintf(buf, size, "killed by signal %d (%s)", WTERMSIG(status), strsignal(WTERMSIG(status)));
+    else snprintf(buf, size, "exited with status %d", WEXITSTATUS(status));
+}
+
+// Close a group's links so the rest of the pipeline runs to completion without it
+static void abandon_group(isolate_t* iso, int g)
+{
+    iso->groups[g].state = ISOLATE_ABANDONED;
+    iso->groups[g].pid = -1;
+    shm_ring_abandon(iso->rings[g]);
+    if (g + 1 < iso->num_groups) shm_ring_finish(iso->rings[g + 1]);
+}
+
+static void* supervise(void* arg)
+{
+    isolate_t* iso = arg;
+    int active = iso->num_groups;
+    while (active > 0)
+    {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+        {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        int g = 0;
+        while (g < iso->num_groups && iso->groups[g].pid != pid) g++;
+        if (g == iso->num_groups) continue;
+        isolate_group_t* group = &iso->groups[g];
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        {
+            group->state = ISOLATE_DONE;
+            group->pid = -1;
+            active--;
+            continue;
+        }
+
+        char how[96];
+        describe_status(status, how, sizeof(how));
+        if (group->restarts < ISOLATE_MAX_RESTARTS)
+        {
+            group->restarts++;
+            fprintf(stderr, "Stage process %s (pid %d) %s, restarting (%d/%d)\n",
+                    group->label, (int)pid, how, group->restarts, ISOLATE_MAX_RESTARTS);
+            group->pid = spawn_group(iso, g);
+            if (group->pid > 0) continue;
+        }
+        fprintf(stderr, "Stage process %s (pid %d) %s, giving up on it\n", group->label, (int)pid, how);
+        abandon_group(iso, g);
+        active--;
+    }
+    return NULL;
+}
+
+static void free_iso(isolate_t* iso)
+{
+    for (int g = 0; iso->rings && g < iso->num_groups; g++)
+    {
+        if (iso->rings[g]) shm_ring_unmap(iso->rings[g]);
+        if (iso->fds[g] >= 0) close(iso->fds[g]);
+    }
+    for (int g = 0; iso->worker_specs && g < iso->num_groups; g++) free(iso->worker_specs[g]);
+    free(iso->groups);
+    free(iso->rings);
+    free(iso->fds);
+    free(iso->worker_specs);
+    memset(iso, 0, sizeof(*iso));
+}
+
+// Kill and reap every started process
+static void kill_groups(isolate_t* iso)
+{
+    for (int g = 0; g < iso->num_groups; g++)
+    {
+        if (iso->groups[g].pid > 0) kill(iso->groups[g].pid, SIGKILL);
+    }
+    for (int g = 0; g < iso->num_groups; g++)
+    {
+        if (iso->groups[g].pid > 0) waitpid(iso->groups[g].pid, NULL, 0);
+    }
+}
+
+const char* isolate_start(isolate_t* iso, char** argv, const char* const* names, const int* sizes, int num_groups)
+{
+    if (!iso || !argv || !names || !sizes || num_groups < 1) return "Invalid parameters";
+    memset(iso, 0, sizeof(*iso));
+    iso->num_groups = num_groups;
+    iso->argv = argv;
+    iso->groups = calloc(num_groups, sizeof(isolate_group_t));
+    iso->rings = calloc(num_groups, sizeof(shm_ring_t*));
+    iso->fds = malloc(num_groups * sizeof(int));
+    iso->worker_specs = calloc(num_groups, sizeof(char*));
+    if (!iso->groups || !iso->rings || !iso->fds || !iso->worker_specs)
+    {
+        free_iso(iso);
+        return "Memory allocation failed";
+    }
+    for (int g = 0; g < num_groups; g++) iso->fds[g] = -1;
+
+    for (int g = 0; g < num_groups; g++)
+    {
+        iso->rings[g] = shm_ring_create(&iso->fds[g]);
+        if (!iso->rings[g])
+        {
+            free_iso(iso);
+            return "Failed to create shared memory ring";
+        }
+    }
+
+    int first = 0;
+    for (int g = 0; g < num_groups; g++)
+    {
+        isolate_group_t* group = &iso->groups[g];
+        group->first = first;
+        group->count = sizes[g];
+        group->pid = -1;
+        size_t used = 0;
+        for (int s = first; s < first + sizes[g]; s++)
+        {
+            int n = snprintf(group->label + used, sizeof(group->label) - used, "%s%s", s > first ? "+" : "", names[s]);
+            if (n < 0 || (size_t)n >= sizeof(group->label) - used) break;
+            used += (size_t)n;
+        }
+
+        char spec[64];
+        snprintf(spec, sizeof(spec), "%d,%d,%d,%d", iso->fds[g], g + 1 < num_groups ? iso->fds[g + 1] : -1,
+                 first, sizes[g]);
+        iso->worker_specs[g] = strdup(spec);
+        if (!iso->worker_specs[g])
+        {
+            free_iso(iso);
+            return "Memory allocation failed";
+        }
+        first += sizes[g];
+    }
+
+    for (int g = 0; g < num_groups; g++)
+    {
+        iso->groups[g].pid = spawn_group(iso, g);
+        if (iso->groups[g].pid < 0)
+        {
+            kill_groups(iso);
+            free_iso(iso);
+            return "Failed to start stage process";
+        }
+    }
+
+    // Each worker marks its input ring ready once its plugins are initialized;
+    // one that exits first failed to start and has said why on stderr
+    for (int g = 0; g < num_groups; g++)
+    {
+        while (!atomic_load(&iso->rings[g]->consumer_ready))
+        {
+            if (waitpid(iso->groups[g].pid, NULL, WNOHANG) == iso->groups[g].pid)
+            {
+                iso->groups[g].pid = -1;
+                kill_groups(iso);
+                free_iso(iso);
+                return "Stage process failed to initialize";
+            }
+            struct timespec delay = { 0, ISOLATE_POLL_MS * 1000000L };
+            nanosleep(&delay, NULL);
+        }
+    }
+
+    if (pthread_create(&iso->supervisor, NULL, supervise, iso) != 0)
+    {
+        kill_groups(iso);
+        free_iso(iso);
+        return "Failed to create supervisor thread";
+    }
+    iso->supervising = 1;
+    return NULL;
+}
+
+shm_ring_t* isolate_input(isolate_t* iso)
+{
+    return iso && iso->rings ? iso->rings[0] : NULL;
+}
+
+int isolate_wait(isolate_t* iso)
+{
+    if (!iso || !iso->supervising) return -1;
+    pthread_join(iso->supervisor, NULL);
+    iso->supervising = 0;
+
+    int rc = 0;
+    for (int g = 0; g < iso->num_groups; g++)
+    {
+        const isolate_group_t* group = &iso->groups[g];
+        if (group->state == ISOLATE_ABANDONED)
+        {
+            fprintf(stderr, "Stage process %s: abandoned after %d restarts, %lu records refused\n", group->label,
+                    group->restarts, atomic_load(&iso->rings[g]->refused));
+            rc = -1;
+        }
+        else if (group->restarts > 0)
+        {
+            fprintf(stderr, "Stage process %s: restarted %d times\n", group->label, group->restarts);
+        }
+    }
+    return rc;
+}
+
+void isolate_destroy(isolate_t* iso)
+{
+    if (iso) free_iso(iso);
+}
+
+int isolate_parse_worker(const char* value, int* in_fd, int* out_fd, int* first, int* count)
+{
+    char tail;
+    if (sscanf(value, "%d,%d,%d,%d%c", in_fd, out_fd, first, count, &tail) != 4) return -1;
+    if (*in_fd < 0 || *out_fd < -1 || *first < 0 || *count < 1) return -1;
+    return 0;
+}
@@ -0,0 +1,95 @@
+#ifndef ISOLATE_H
+#define ISOLATE_H
+
+#include <pthread.h>
+#include <sys/types.h>
+#include "shm_ring.h"
+
+#define ISOLATE_MAX_RESTARTS 3      /* restarts per group before it is abandoned */
+
+/**
+ * State of one stage group's process
+ */
+typedef enum
+{
+    ISOLATE_RUNNING = 0,    /* Process alive (or being restarted) */
+    ISOLATE_DONE,           /* Exited cleanly after forwarding <END> */
+    ISOLATE_ABANDONED       /* Crashed too often; its links were closed */
+} isolate_state_t;
+
+typedef struct
+{
+    pid_t pid;
+    int first;              /* Index of the group's first stage */
+    int count;              /* Number of stages in the group */
+    int restarts;
+    isolate_state_t state;
+    char label[128];        /* Stage names joined with '+' */
+} isolate_group_t;
+
+/**
+ * Pipeline split into stage groups, each in its own process started from the
+ * analyzer binary in worker mode. Ring g feeds group g; group g's last stage
+ * writes ring g + 1. A supervisor thread reaps the processes, restarts a group
+ * that dies before exiting cleanly (records it held in flight are lost) and
+ * abandons it after ISOLATE_MAX_RESTARTS, finishing its output ring so the
+ * stages behind it still shut down.
+ */
+typedef struct
+{
+    int num_groups;
+    isolate_group_t* groups;
+    shm_ring_t** rings;     /* num_groups rings */
+    int* fds;               /* memfd of each ring */
+    char** argv;            /* Worker command line; argv[2] is set per group */
+    char** worker_specs;    /* "--stage-worker" value of each group */
+    pthread_t supervisor;
+    int supervising;
+} isolate_t;
+
+/**
+ * Create the rings and start one process per group, waiting until every
+ * group has initialized its plugins
+ * @param iso  Pointer to isolate structure
+ * @param argv  NULL-terminated worker command line: argv[0] is the program, argv[1]
+ *              "--stage-worker" and argv[2] a placeholder for the group's value
+ * @param names  Name of every stage, for messages
+ * @param sizes  Number of stages in each group
+ * @param num_groups  Number of groups
+ * @return  NULL on success, error message on failure (started processes are killed)
+ */
+const char* isolate_start(isolate_t* iso, char** argv, const char* const* names, const int* sizes, int num_groups);
+
+/**
+ * Ring feeding the first group, for ingest
+ * @param iso  Pointer to isolate structure
+ * @return  The first ring
+ */
+shm_ring_t* isolate_input(isolate_t* iso);
+
+/**
+ * Wait until every group has exited or been abandoned, after ingest finished
+ * the input ring, and report restarts
+ * @param iso  Pointer to isolate structure
+ * @return  0 if every group finished, -1 if any was abandoned
+ */
+int isolate_wait(isolate_t* iso);
+
+/**
+ * Unmap and close the rings and free the structure's memory
+ * @param iso  Pointer to isolate structure
+ */
+void isolate_destroy(isolate_t* iso);
+
+/**
+ * Parse a worker's "--stage-worker" value
+ * @param value  "IN_FD,OUT_FD,FIRST,COUNT" (OUT_FD is -1 for the last group)
+ * @param in_fd  Receives the input ring's memfd
+ * @param out_fd  Receives the output ring's memfd or -1
+ * @param first  Receives the index of the group's first stage
+ * @param count  Receives the number of stages in the group
+ * @return  0 on success, -1 if malformed
+ */
+int isolate_parse_worker(const char* value, int* in_fd, int* out_fd, int* first, int* count);
+
+#endif // ISOLATE_H
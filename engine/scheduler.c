@@ -0,0 +1,293 @@
+#include "scheduler.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+// Task states
+enum
+{
+    TASK_IDLE = 0,      // not queued, waiting for scheduler_wake
+    TASK_QUEUED,        // sitting in exactly one deque
+    TASK_RUNNING,       // owned by a worker
+    TASK_RERUN,         // woken while running; requeue when it returns
+    TASK_DONE           // finished, wakes are ignored
+};
+
+// Worker identity of the calling thread, so wakes from inside a task stay local
+static __thread scheduler_t* tls_sched = NULL;
+static __thread int tls_worker = -1;
+
+typedef struct
+{
+    scheduler_t* sched;
+    int index;
+} worker_arg_t;
+
+static int deque_init(sched_deque_t* dq, int capacity)
+{
+    dq->slots = malloc(capacity * sizeof(int));
+    if (!dq->slots) return -1;
+    if (pthread_mutex_init(&dq->mutex, NULL) != 0)
+    {
+        free(dq->slots);
+        return -1;
+    }
+    dq->capacity = capacity;
+    dq->head = 0;
+    dq->count = 0;
+    return 0;
+}
+
+static void deque_destroy(sched_deque_t* dq)
+{
+    pthread_mutex_destroy(&dq->mutex);
+    free(dq->slots);
+}
+
+static void deque_push_bottom(sched_deque_t* dq, int task)
+{
+    pthread_mutex_lock(&dq->mutex);
+    dq->slots[(dq->head + dq->count) % dq->capacity] = task;
+    dq->count++;
+    pthread_mutex_unlock(&dq->mutex);
+}
+
+static void deque_push_top(sched_deque_t* dq, int task)
+{
+    pthread_mutex_lock(&dq->mutex);
+    dq->head = (dq->head + dq->capacity - 1) % dq->capacity;
+    dq->slots[dq->head] = task;
+    dq->count++;
+    pthread_mutex_unlock(&dq->mutex);
+}
+
+static int deque_pop_bottom(sched_deque_t* dq)
+{
+    int task = -1;
+    pthread_mutex_lock(&dq->mutex);
+    if (dq->count > 0)
+    {
+        dq->count--;
+        task = dq->slots[(dq->head + dq->count) % dq->capacity];
+    }
+    pthread_mutex_unlock(&dq->mutex);
+    return task;
+}
+
+static int deque_steal_top(sched_deque_t* dq)
+{
+    int task = -1;
+    pthread_mutex_lock(&dq->mutex);
+    if (dq->count > 0)
+    {
+        task = dq->slots[dq->head];
+        dq->head = (dq->head + 1) % dq->capacity;
+        dq->count--;
+    }
+    pthread_mutex_unlock(&dq->mutex);
+    return task;
+}
+
+// Queue a task that has already been moved to TASK_QUEUED.
+// top != 0 puts it behind everything else in the deque (a yield).
+static void enqueue(scheduler_t* sched, int task, int top)
+{
+    int target;
+    if (tls_sched == sched && tls_worker >= 0) target = tls_worker;
+    else target = (int)(atomic_fetch_add(&sched->next_deque, 1) % (unsigned)sched->num_workers);
+
+    if (top) deque_push_top(&sched->deques[target], task);
+    else deque_push_bottom(&sched->deques[target], task);
+
+    atomic_fetch_add(&sched->pending, 1);
+    // Sleepers register before re-checking pending, so reading sleepers after
+    // publishing pending cannot miss a worker that is about to park
+    if (atomic_load(&sched->sleepers) > 0)
+    {
+        pthread_mutex_lock(&sched->idle_mutex);
+        pthread_cond_signal(&sched->idle_cond);
+        pthread_mutex_unlock(&sched->idle_mutex);
+    }
+}
+
+void scheduler_wake(scheduler_t* sched, int task)
+{
+    if (!sched || task < 0 || task >= sched->num_tasks) return;
+
+    int state = atomic_load(&sched->state[task]);
+    for (;;)
+    {
+        if (state == TASK_IDLE)
+        {
+            if (atomic_compare_exchange_weak(&sched->state[task], &state, TASK_QUEUED))
+            {
+                enqueue(sched, task, 0);
+                return;
+            }
+        }
+        else if (state == TASK_RUNNING)
+        {
+            if (atomic_compare_exchange_weak(&sched->state[task], &state, TASK_RERUN)) return;
+        }
+        else
+        {
+            return; // already queued, already flagged for rerun, or done
+        }
+    }
+}
+
+// Find work: own deque first (LIFO keeps hand-offs cache-hot), then steal
+static int next_task(scheduler_t* sched, int self)
+{
+    int task = deque_pop_bottom(&sched->deques[self]);
+    for (int i = 1; task < 0 && i < sched->num_workers; i++)
+    {
+        task = deque_steal_top(&sched->deques[(self + i) % sched->num_workers]);
+    }
+    return task;
+}
+
+static void* worker_main(void* arg)
+{
+    worker_arg_t* warg = arg;
+    scheduler_t* sched = warg->sched;
+    int self = warg->index;
+    free(warg);
+
+    tls_sched = sched;
+    tls_worker = self;
+
+    for (;;)
+    {
+        int task = next_task(sched, self);
+        if (task < 0)
+        {
+            pthread_mutex_lock(&sched->idle_mutex);
+            atomic_fetch_add(&sched->sleepers, 1);
+            while (atomic_load(&sched->pending) == 0 && !atomic_load(&sched->stop))
+            {
+                pthread_cond_wait(&sched->idle_cond, &sched->idle_mutex);
+            }
+            atomic_fetch_sub(&sched->sleepers, 1);
+            pthread_mutex_unlock(&sched->idle_mutex);
+            if (atomic_load(&sched->stop)) break;
+            continue;
+        }
+
+        atomic_fetch_sub(&sched->pending, 1);
+        atomic_store(&sched->state[task], TASK_RUNNING);
+        sched_status_t status = sched->run(sched->args[task]);
+
+        if (status == SCHED_TASK_DONE)
+        {
+            atomic_store(&sched->state[task], TASK_DONE);
+            continue;
+        }
+
+        int expected = TASK_RUNNING;
+        if (status == SCHED_TASK_IDLE &&
+            atomic_compare_exchange_strong(&sched->state[task], &expected, TASK_IDLE))
+        {
+            continue;
+        }
+        // More work, or woken while running: requeue
+        atomic_store(&sched->state[task], TASK_QUEUED);
+        enqueue(sched, task, status == SCHED_TASK_AGAIN);
+    }
+    return NULL;
+}
+
+const char* scheduler_init(scheduler_t* sched, int num_workers, int num_tasks, sched_task_fn run, void** args)
+{
+    if (!sched || num_workers < 1 || num_tasks < 1 || !run || !args) return "Invalid parameters";
+
+    sched->num_workers = num_workers;
+    sched->started = 0;
+    sched->num_tasks = num_tasks;
+    sched->run = run;
+    sched->args = args;
+    atomic_init(&sched->pending, 0);
+    atomic_init(&sched->sleepers, 0);
+    atomic_init(&sched->next_deque, 0);
+    atomic_init(&sched->stop, 0);
+
+    sched->state = malloc(num_tasks * sizeof(atomic_int));
+    sched->deques = calloc(num_workers, sizeof(sched_deque_t));
+    sched->threads = calloc(num_workers, sizeof(pthread_t));
+    if (!sched->state || !sched->deques || !sched->threads)
+    {
+        free(sched->state);
+        free(sched->deques);
+        free(sched->threads);
+        return "Memory allocation failed";
+    }
+    for (int i = 0; i < num_tasks; i++) atomic_init(&sched->state[i], TASK_IDLE);
+
+    if (pthread_mutex_init(&sched->idle_mutex, NULL) != 0 || pthread_cond_init(&sched->idle_cond, NULL) != 0)
+    {
+        free(sched->state);
+        free(sched->deques);
+        free(sched->threads);
+        return "Failed to initialize scheduler lock";
+    }
+
+    for (int i = 0; i < num_workers; i++)
+    {
+        if (deque_init(&sched->deques[i], num_tasks) != 0)
+        {
+            for (int j = 0; j < i; j++) deque_destroy(&sched->deques[j]);
+            pthread_cond_destroy(&sched->idle_cond);
+            pthread_mutex_destroy(&sched->idle_mutex);
+            free(sched->state);
+            free(sched->deques);
+            free(sched->threads);
+            return "Memory allocation failed";
+        }
+    }
+
+    for (int i = 0; i < num_workers; i++)
+    {
+        worker_arg_t* warg = malloc(sizeof(*warg));
+        if (warg)
+        {
+            warg->sched = sched;
+            warg->index = i;
+        }
+        if (!warg || pthread_create(&sched->threads[i], NULL, worker_main, warg) != 0)
+        {
+            free(warg);
+            // Workers started so far are stopped and joined by scheduler_destroy
+            scheduler_destroy(sched);
+            return "Failed to create worker thread";
+        }
+        sched->started++;
+    }
+    return NULL;
+}
+
+void scheduler_destroy(scheduler_t* sched)
+{
+    if (!sched) return;
+
+    pthread_mutex_lock(&sched->idle_mutex);
+    atomic_store(&sched->stop, 1);
+    pthread_cond_broadcast(&sched->idle_cond);
+    pthread_mutex_unlock(&sched->idle_mutex);
+
+    for (int i = 0; i < sched->started; i++) pthread_join(sched->threads[i], NULL);
+    for (int i = 0; i < sched->num_workers; i++) deque_destroy(&sched->deques[i]);
+
+    pthread_cond_destroy(&sched->idle_cond);
+    pthread_mutex_destroy(&sched->idle_mutex);
+    free(sched->state);
+    free(sched->deques);
+    free(sched->threads);
+    sched->state = NULL;
+    sched->deques = NULL;
+    sched->threads = NULL;
+}
+
+int scheduler_cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
@@ -0,0 +1,85 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/**
+ * Result of running a task once  
+ */
+typedef enum
+{
+    SCHED_TASK_IDLE = 0,    /* Nothing left to do until scheduler_wake() */
+    SCHED_TASK_AGAIN,       /* More work is ready; requeue behind other tasks */
+    SCHED_TASK_DONE         /* Task finished for good */
+} sched_status_t;
+
+typedef sched_status_t (*sched_task_fn)(void* arg);
+
+/**
+ * Per-worker deque of task indices. The owner pushes and pops at the bottom,
+ * thieves take from the top. Each task is queued at most once, so a deque
+ * never holds more than num_tasks entries.
+ */
+typedef struct
+{
+    pthread_mutex_t mutex;  /* Protects the fields below */
+    int* slots;             /* Ring of task indices */
+    int capacity;           /* Number of slots */
+    int head;               /* Index of the top entry */
+    int count;              /* Number of queued tasks */
+} sched_deque_t;
+
+/**
+ * Fixed pool of workers running tasks from work-stealing deques. A task is
+ * never run by two workers at once, so per-task FIFO order is preserved.
+ */
+typedef struct
+{
+    int num_workers;            /* Number of worker threads */
+    pthread_t* threads;         /* Worker threads */
+    int started;                /* Workers successfully created */
+    sched_deque_t* deques;      /* One deque per worker */
+    int num_tasks;              /* Number of tasks */
+    sched_task_fn run;          /* Task body */
+    void** args;                /* Per-task argument for run */
+    atomic_int* state;          /* Per-task state (see scheduler.c) */
+    atomic_int pending;         /* Tasks sitting in deques */
+    atomic_int sleepers;        /* Workers parked on idle_cond */
+    atomic_uint next_deque;     /* Round-robin target for wakes from non-workers */
+    atomic_int stop;            /* Set by scheduler_destroy */
+    pthread_mutex_t idle_mutex; /* Parks idle workers */
+    pthread_cond_t idle_cond;   /* Signalled when a task is queued */
+} scheduler_t;
+
+/**
+ * Create the pool and start its workers. Tasks start idle.  
+ * @param sched  Pointer to scheduler structure  
+ * @param num_workers  Number of worker threads (>= 1)  
+ * @param num_tasks  Number of tasks  
+ * @param run  Task body  
+ * @param args  Per-task arguments (array of num_tasks, must outlive the scheduler)  
+ * @return  NULL on success, error message on failure  
+ */
+const char* scheduler_init(scheduler_t* sched, int num_workers, int num_tasks, sched_task_fn run, void** args);
+
+/**
+ * Mark a task runnable. Safe from any thread, including from inside a task.  
+ * Waking a running task makes it run again after it returns.  
+ * @param sched  Pointer to scheduler structure  
+ * @param task  Task index  
+ */
+void scheduler_wake(scheduler_t* sched, int task);
+
+/**
+ * Stop the workers and free resources. Tasks still queued are not run.  
+ * @param sched  Pointer to scheduler structure  
+ */
+void scheduler_destroy(scheduler_t* sched);
+
+/**
+ * Number of online CPUs, at least 1  
+ */
+int scheduler_cpu_count(void);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,462 @@
+#define _GNU_SOURCE
+#include "server.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "varint.h"
+
+#define SENTINEL_END "<END>"
+#define SERVER_LINE_MAX 1024            // same framing as stdin
+#define SERVER_CONN_BUFFER (64 * 1024)  // unread input held per connection
+#define SERVER_BATCH 64                 // lines taken from one connection per round
+#define SERVER_MAX_EVENTS 64
+#define SERVER_RETRY_MS 1               // poll interval while the first queue is full
+
+// What an epoll registration refers to
+enum
+{
+    ENDPOINT_LISTEN = 0,
+    ENDPOINT_SIGNAL,
+    ENDPOINT_CONN
+};
+
+typedef struct
+{
+    int kind;
+    int fd;
+    char* buf;              // SERVER_CONN_BUFFER bytes plus room for a terminator
+    size_t start;           // first unconsumed byte
+    size_t end;             // end of received data
+    int armed;              // registered for EPOLLIN
+    int eof;                // peer closed: deliver what is buffered, then close
+    int ended;              // peer sent <END>: close now
+} conn_t;
+
+typedef struct
+{
+    int epoll_fd;
+    conn_t listener;
+    conn_t signals;
+    conn_t** conns;
+    int num_conns;
+    int cap_conns;
+    char unix_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+    int started;            // listening and serving
+    int stopping;
+    ingest_framing_t framing;
+    unsigned long accepted;
+    unsigned long records;
+} server_t;
+
+static int is_sentinel(const char* data, size_t len)
+{
+    return len == sizeof(SENTINEL_END) - 1 && memcmp(data, SENTINEL_END, len) == 0;
+}
+
+static int parse_port(const char* text, int* port)
+{
+    char* end;
+    errno = 0;
+    long p = strtol(text, &end, 10);
+    if (errno == ERANGE || end == text || *end != '\0' || p < 1 || p > 65535) return -1;
+    *port = (int)p;
+    return 0;
+}
+
+int server_parse_check(const char* address)
+{
+    int port;
+    if (!address) return -1;
+    if (strncmp(address, "unix:", 5) == 0)
+    {
+        size_t len = strlen(address + 5);
+        return len > 0 && len < sizeof(((struct sockaddr_un*)0)->sun_path) ? 0 : -1;
+    }
+    if (strncmp(address, "tcp:", 4) == 0) return parse_port(address + 4, &port);
+    return -1;
+}
+
+static const char* server_listen(server_t* server, const char* address)
+{
+    int fd;
+    if (strncmp(address, "unix:", 5) == 0)
+    {
+        const char* path = address + 5;
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+        // Replace a stale socket left by a previous run, but never a regular file
+        struct stat st;
+        if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return "Failed to create socket";
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+        {
+            close(fd);
+            return "Failed to bind Unix socket";
+        }
+        strncpy(server->unix_path, path, sizeof(server->unix_path) - 1);
+    }
+    else
+    {
+        int port;
+        if (strncmp(address, "tcp:", 4) != 0 || parse_port(address + 4, &port) != 0) return "Invalid listen address";
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // local producers only
+
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return "Failed to create socket";
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+        {
+            close(fd);
+            return "Failed to bind TCP port";
+        }
+    }
+
+    if (listen(fd, SOMAXCONN) != 0)
+    {
+        close(fd);
+        return "Failed to listen";
+    }
+    server->listener.kind = ENDPOINT_LISTEN;
+    server->listener.fd = fd;
+    return NULL;
+}
+
+static int epoll_add(server_t* server, conn_t* endpoint)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = endpoint;
+    return epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, endpoint->fd, &ev);
+}
+
+static void conn_close(server_t* server, int index)
+{
+    conn_t* conn = server->conns[index];
+    close(conn->fd); // also drops the epoll registration
+    free(conn->buf);
+    free(conn);
+    server->conns[index] = server->conns[--server->num_conns];
+}
+
+static void accept_all(server_t* server)
+{
+    for (;;)
+    {
+        int fd = accept4(server->listener.fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
+
+        if (server->num_conns == server->cap_conns)
+        {
+            int cap = server->cap_conns ? server->cap_conns * 2 : 16;
+            conn_t** grown = realloc(server->conns, cap * sizeof(conn_t*));
+            if (!grown)
+            {
+                close(fd);
+                continue;
+            }
+            server->conns = grown;
+            server->cap_conns = cap;
+        }
+
+        conn_t* conn = calloc(1, sizeof(conn_t));
+        if (conn) conn->buf = malloc(SERVER_CONN_BUFFER + 1);
+        if (!conn || !conn->buf)
+        {
+            if (conn) free(conn);
+            close(fd);
+            continue;
+        }
+        conn->kind = ENDPOINT_CONN;
+        conn->fd = fd;
+        if (epoll_add(server, conn) != 0)
+        {
+            free(conn->buf);
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->armed = 1;
+        server->conns[server->num_conns++] = conn;
+        server->accepted++;
+    }
+}
+
+static void conn_read(conn_t* conn)
+{
+    if (conn->start > 0 && conn->end == SERVER_CONN_BUFFER)
+    {
+        memmove(conn->buf, conn->buf + conn->start, conn->end - conn->start);
+        conn->end -= conn->start;
+        conn->start = 0;
+    }
+    size_t room = SERVER_CONN_BUFFER - conn->end;
+    if (room == 0) return;
+
+    ssize_t n = read(conn->fd, conn->buf + conn->end, room);
+    if (n > 0) conn->end += (size_t)n;
+    else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) conn->eof = 1;
+}
+
+// Find the next varint-framed record: payload at offset *skip, *len bytes.
+// A malformed or oversized prefix, or a stream cut mid-record, drops the connection.
+static int conn_next_framed(conn_t* conn, size_t* skip, size_t* len, size_t* consumed)
+{
+    size_t avail = conn->end - conn->start;
+    if (avail == 0) return 0;
+
+    uint64_t n;
+    size_t used;
+    int rc = varint_decode((const unsigned char*)conn->buf + conn->start, avail, &n, &used);
+    const char* problem = NULL;
+    if (rc < 0) problem = "malformed record length";
+    else if (rc == 1 && n > SERVER_CONN_BUFFER - VARINT_MAX_BYTES) problem = "record larger than the connection buffer";
+    else if (rc == 1 && n <= avail - used)
+    {
+        *skip = used;
+        *len = (size_t)n;
+        *consumed = used + (size_t)n;
+        return 1;
+    }
+    else if (conn->eof) problem = "truncated record";
+
+    if (problem)
+    {
+        fprintf(stderr, "Warning: closing connection: %s\n", problem);
+        conn->ended = 1;
+    }
+    return 0;
+}
+
+// Find the next record: for lines, what fgets into a 1025-byte buffer would
+// return: up to the newline, a full 1024-byte piece, or the trailing bytes
+// once the peer is done
+static int conn_next_record(const server_t* server, conn_t* conn, size_t* skip, size_t* len, size_t* consumed)
+{
+    if (server->framing == INGEST_FRAMING_VARINT) return conn_next_framed(conn, skip, len, consumed);
+
+    size_t avail = conn->end - conn->start;
+    if (avail == 0) return 0;
+
+    *skip = 0;
+    const char* p = conn->buf + conn->start;
+    size_t scan = avail < SERVER_LINE_MAX ? avail : SERVER_LINE_MAX;
+    const char* nl = memchr(p, '\n', scan);
+    if (nl)
+    {
+        *len = (size_t)(nl - p);
+        *consumed = *len + 1;
+    }
+    else if (avail >= SERVER_LINE_MAX || conn->eof)
+    {
+        *len = scan;
+        *consumed = scan;
+    }
+    else
+    {
+        return 0;
+    }
+    return 1;
+}
+
+static const char* place_record(const ingest_sink_t* sink, char* line, size_t len)
+{
+    if (sink->place_slice) return ingest_place_record(sink, line, len, 0);
+
+    // Hold ingest back while queued bytes exceed the budget
+    mem_budget_wait(sink->budget, mem_budget_item_size(len));
+
+    // Terminate in place; the byte after the line is restored for the next one
+    char saved = line[len];
+    line[len] = '\0';
+    const char* error = sink->place_work(line);
+    line[len] = saved;
+    return error;
+}
+
+// Deliver up to max records from one connection.
+// Returns the number placed, or -1 when the first queue has no room.
+static int conn_drain(server_t* server, conn_t* conn, int max, const ingest_sink_t* sink, const char** error)
+{
+    if (sink->queue_space)
+    {
+        int space = sink->queue_space();
+        if (space <= 0) return -1;
+        if (space < max) max = space;
+    }
+
+    int placed = 0;
+    size_t skip, len, consumed;
+    while (placed < max && !conn->ended && conn_next_record(server, conn, &skip, &len, &consumed))
+    {
+        char* line = conn->buf + conn->start + skip;
+        conn->start += consumed;
+        if (is_sentinel(line, len))
+        {
+            // Ends this producer's stream, not the shared pipeline
+            conn->ended = 1;
+            break;
+        }
+        *error = place_record(sink, line, len);
+        if (*error) break;
+        placed++;
+        server->records++;
+    }
+    if (conn->start == conn->end) conn->start = conn->end = 0;
+    return placed;
+}
+
+// Read from a connection only while its buffer has room. A stalled producer
+// then fills its socket buffer and blocks in write() without affecting others.
+static void conn_update_interest(server_t* server, conn_t* conn)
+{
+    int want = !conn->eof && (conn->start > 0 || conn->end < SERVER_CONN_BUFFER);
+    if (want == conn->armed) return;
+    if (want) epoll_add(server, conn);
+    else epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    conn->armed = want;
+}
+
+static void server_stop(server_t* server)
+{
+    server->stopping = 1;
+    close(server->listener.fd); // no new connections
+    server->listener.fd = -1;
+    // Deliver what has been received, including unterminated last lines
+    for (int i = 0; i < server->num_conns; i++) server->conns[i]->eof = 1;
+}
+
+const char* ingest_server(const char* address, const ingest_sink_t* sink, ingest_framing_t framing)
+{
+    if (!address || !sink || !sink->place_work) return "Invalid parameters";
+
+    server_t server;
+    memset(&server, 0, sizeof(server));
+    server.listener.fd = -1;
+    server.signals.fd = -1;
+    server.epoll_fd = -1;
+    server.framing = framing;
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+
+    const char* error = server_listen(&server, address);
+    if (!error)
+    {
+        server.signals.kind = ENDPOINT_SIGNAL;
+        server.signals.fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        server.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (server.signals.fd < 0 || server.epoll_fd < 0 ||
+            epoll_add(&server, &server.listener) != 0 || epoll_add(&server, &server.signals) != 0)
+        {
+            error = "Failed to set up epoll";
+        }
+    }
+    if (!error)
+    {
+        server.started = 1;
+        fprintf(stderr, "Listening on %s (SIGINT or SIGTERM to finish)\n", address);
+    }
+
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    while (!error)
+    {
+        // Round-robin over connections so one busy producer cannot starve the rest
+        int full = 0;
+        for (int i = 0; i < server.num_conns && !error; i++)
+        {
+            if (conn_drain(&server, server.conns[i], SERVER_BATCH, sink, &error) < 0)
+            {
+                full = 1;
+                break;
+            }
+        }
+        if (error) break;
+
+        int pending = 0;
+        for (int i = 0; i < server.num_conns; i++)
+        {
+            conn_t* conn = server.conns[i];
+            size_t skip, len, consumed;
+            if (conn->ended || (conn->eof && conn->start == conn->end))
+            {
+                conn_close(&server, i--);
+                continue;
+            }
+            conn_update_interest(&server, conn);
+            if (!conn->ended && conn_next_record(&server, conn, &skip, &len, &consumed)) pending = 1;
+        }
+        if (server.stopping && !pending) break;
+
+        int timeout = full ? SERVER_RETRY_MS : (pending ? 0 : -1);
+        int n = epoll_wait(server.epoll_fd, events, SERVER_MAX_EVENTS, timeout);
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+            error = "epoll_wait failed";
+            break;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            conn_t* endpoint = events[i].data.ptr;
+            if (endpoint->kind == ENDPOINT_LISTEN)
+            {
+                if (!server.stopping) accept_all(&server);
+            }
+            else if (endpoint->kind == ENDPOINT_SIGNAL)
+            {
+                struct signalfd_siginfo info;
+                while (read(server.signals.fd, &info, sizeof(info)) == sizeof(info))
+                    ;
+                if (!server.stopping) server_stop(&server);
+            }
+            else
+            {
+                conn_read(endpoint);
+            }
+        }
+    }
+
+    while (server.num_conns > 0) conn_close(&server, server.num_conns - 1);
+    free(server.conns);
+    if (server.listener.fd >= 0) close(server.listener.fd);
+    if (server.signals.fd >= 0) close(server.signals.fd);
+    if (server.epoll_fd >= 0) close(server.epoll_fd);
+    if (server.unix_path[0]) unlink(server.unix_path);
+
+    if (server.started) fprintf(stderr, "Server: %lu connections, %lu records\n", server.accepted, server.records);
+
+    // The pipeline always ends, even after a setup failure
+    const char* end_error = sink->place_work(SENTINEL_END);
+    return error ? error : end_error;
+}
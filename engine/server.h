@@ -0,0 +1,33 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "ingest.h"
+
+/**
+ * Serve the pipeline to local producers until SIGINT or SIGTERM.
+ * Accepts any number of connections on a Unix domain socket or a loopback
+ * TCP port and multiplexes them with epoll. Each connection is framed like
+ * stdin (lines of up to 1024 bytes, or varint-framed records of up to the
+ * 64 KiB connection buffer); records of one connection keep their order,
+ * records of different connections are interleaved. A connection sending
+ * "<END>" is closed without ending the pipeline. On shutdown buffered
+ * records are delivered and "<END>" is sent downstream.
+ *
+ * The caller must block SIGINT and SIGTERM in every thread (i.e. before
+ * plugins start theirs), so they are only received through the server.
+ *
+ * @param address  "unix:PATH" or "tcp:PORT" (bound to 127.0.0.1)
+ * @param sink  Destination of the records
+ * @param framing  Wire format of every connection
+ * @return  NULL on success, error message on failure
+ */
+const char* ingest_server(const char* address, const ingest_sink_t* sink, ingest_framing_t framing);
+
+/**
+ * Check an address without binding it
+ * @param address  Address as accepted by ingest_server
+ * @return  0 if well formed, -1 otherwise
+ */
+int server_parse_check(const char* address);
+
+#endif // SERVER_H
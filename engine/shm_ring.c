@@ -0,0 +1,323 @@
+#define _GNU_SOURCE
+#include "shm_ring.h"
+#include <limits.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "consumer_producer.h"
+
+#define SENTINEL_END "<END>"
+#define SHM_RING_MASK ((uint64_t)SHM_RING_BYTES - 1)
+#define SHM_RING_SPIN 16            // yields to the peer process before parking on the futex
+#define SHM_RING_WAIT_MS 100        // parked sides recheck for an abandoned peer this often
+
+// Ring-internal record flags, above the CP_ITEM_* bits
+#define SHM_REC_PAD  0x80000000u    // filler up to the end of the data area
+#define SHM_REC_MORE 0x40000000u    // more pieces of this record follow
+#define SHM_REC_CONT 0x20000000u    // continues the previous piece
+
+typedef struct
+{
+    uint32_t len;           // payload bytes (for padding: bytes to skip, header included)
+    uint32_t flags;
+} shm_rec_t;
+
+static shm_ring_t* g_output = NULL;
+
+// Not FUTEX_*_PRIVATE: the words live in a mapping shared between processes
+static void futex_wait(atomic_uint* word, unsigned expected)
+{
+    struct timespec timeout = { 0, SHM_RING_WAIT_MS * 1000000L };
+    syscall(SYS_futex, (unsigned*)word, FUTEX_WAIT, expected, &timeout, NULL, 0);
+}
+
+static void futex_wake_all(atomic_uint* word)
+{
+    syscall(SYS_futex, (unsigned*)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Header plus payload plus terminator, so place_work can read records in place
+static size_t record_size(size_t len)
+{
+    return (sizeof(shm_rec_t) + len + 1 + 7) & ~(size_t)7;
+}
+
+static shm_ring_t* map_fd(int fd)
+{
+    void* map = mmap(NULL, sizeof(shm_ring_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return map == MAP_FAILED ? NULL : map;
+}
+
+shm_ring_t* shm_ring_create(int* fd)
+{
+    int mfd = memfd_create("analyzer-ring", 0);
+    if (mfd < 0) return NULL;
+    if (ftruncate(mfd, sizeof(shm_ring_t)) != 0)
+    {
+        close(mfd);
+        return NULL;
+    }
+    shm_ring_t* ring = map_fd(mfd);
+    if (!ring)
+    {
+        close(mfd);
+        return NULL;
+    }
+
+    // A fresh memfd reads as zeros; only the atomics need initializing
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->data_seq, 0);
+    atomic_init(&ring->consumer_waiting, 0);
+    atomic_init(&ring->finished, 0);
+    atomic_init(&ring->records, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->space_seq, 0);
+    atomic_init(&ring->producer_waiting, 0);
+    atomic_init(&ring->consumer_ready, 0);
+    atomic_init(&ring->consumer_gone, 0);
+    atomic_init(&ring->refused, 0);
+    *fd = mfd;
+    return ring;
+}
+
+shm_ring_t* shm_ring_map(int fd)
+{
+    return map_fd(fd);
+}
+
+void shm_ring_unmap(shm_ring_t* ring)
+{
+    if (ring) munmap(ring, sizeof(shm_ring_t));
+}
+
+// Wait until total bytes fit behind head
+static const char* wait_space(shm_ring_t* ring, uint64_t head, size_t total)
+{
+    for (int spins = 0;; spins++)
+    {
+        if (atomic_load(&ring->consumer_gone))
+        {
+            atomic_fetch_add_explicit(&ring->refused, 1, memory_order_relaxed);
+            return "Downstream stage process is gone";
+        }
+        uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (SHM_RING_BYTES - (head - tail) >= total) return NULL;
+        if (spins < SHM_RING_SPIN)
+        {
+            sched_yield();
+            continue;
+        }
+
+        // Sample the sequence before re-checking so a release in between is not missed
+        atomic_store(&ring->producer_waiting, 1);
+        unsigned seq = atomic_load(&ring->space_seq);
+        tail = atomic_load(&ring->tail);
+        if (SHM_RING_BYTES - (head - tail) < total && !atomic_load(&ring->consumer_gone))
+        {
+            futex_wait(&ring->space_seq, seq);
+        }
+        atomic_store(&ring->producer_waiting, 0);
+    }
+}
+
+const char* shm_ring_put(shm_ring_t* ring, const char* data, size_t len, unsigned flags)
+{
+    if (!ring || (!data && len > 0)) return "Invalid parameters";
+
+    size_t off = 0;
+    do
+    {
+        size_t piece = len - off < SHM_RING_PIECE ? len - off : SHM_RING_PIECE;
+        unsigned piece_flags = flags & CP_ITEM_CHUNK_MASK;
+        if (off > 0) piece_flags |= SHM_REC_CONT;
+        if (off + piece < len) piece_flags |= SHM_REC_MORE;
+
+        size_t need = record_size(piece);
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        size_t pos = (size_t)(head & SHM_RING_MASK);
+        size_t contiguous = SHM_RING_BYTES - pos;
+        // A record never wraps: pad to the end of the data area and start over at 0
+        size_t total = need <= contiguous ? need : contiguous + need;
+
+        const char* error = wait_space(ring, head, total);
+        if (error) return error;
+
+        if (need > contiguous)
+        {
+            shm_rec_t pad = { (uint32_t)contiguous, SHM_REC_PAD };
+            memcpy(ring->data + pos, &pad, sizeof(pad));
+            pos = 0;
+        }
+        shm_rec_t rec = { (uint32_t)piece, piece_flags };
+        memcpy(ring->data + pos, &rec, sizeof(rec));
+        if (piece) memcpy(ring->data + pos + sizeof(rec), data + off, piece);
+        ring->data[pos + sizeof(rec) + piece] = '\0';
+
+        atomic_store(&ring->head, head + total);
+        atomic_fetch_add(&ring->data_seq, 1);
+        if (atomic_load(&ring->consumer_waiting)) futex_wake_all(&ring->data_seq);
+        off += piece;
+    } while (off < len);
+
+    atomic_fetch_add_explicit(&ring->records, 1, memory_order_relaxed);
+    return NULL;
+}
+
+void shm_ring_finish(shm_ring_t* ring)
+{
+    if (!ring) return;
+    atomic_store(&ring->finished, 1);
+    atomic_fetch_add(&ring->data_seq, 1);
+    futex_wake_all(&ring->data_seq);
+}
+
+void shm_ring_abandon(shm_ring_t* ring)
+{
+    if (!ring) return;
+    atomic_store(&ring->consumer_gone, 1);
+    atomic_fetch_add(&ring->space_seq, 1);
+    futex_wake_all(&ring->space_seq);
+}
+
+void shm_ring_bind_output(shm_ring_t* ring)
+{
+    g_output = ring;
+}
+
+static int is_sentinel(const char* data, size_t len)
+{
+    return len == sizeof(SENTINEL_END) - 1 && memcmp(data, SENTINEL_END, len) == 0;
+}
+
+const char* shm_ring_place_slice(const char* data, size_t len, unsigned flags)
+{
+    if (!g_output) return "No output ring";
+    if (!data) return "Invalid string parameter";
+    // A chunk that happens to read "<END>" is data, not the sentinel
+    if (!(flags & CP_ITEM_CHUNK_MASK) && is_sentinel(data, len))
+    {
+        shm_ring_finish(g_output);
+        return NULL;
+    }
+    return shm_ring_put(g_output, data, len, flags);
+}
+
+const char* shm_ring_place_work(const char* str)
+{
+    if (!str) return "Invalid string parameter";
+    return shm_ring_place_slice(str, strlen(str), 0);
+}
+
+// Wait until head moves past tail or the ring is finished
+static void wait_data(shm_ring_t* ring, uint64_t tail)
+{
+    for (int spins = 0; spins < SHM_RING_SPIN; spins++)
+    {
+        if (atomic_load_explicit(&ring->head, memory_order_acquire) != tail) return;
+        sched_yield();
+    }
+    atomic_store(&ring->consumer_waiting, 1);
+    unsigned seq = atomic_load(&ring->data_seq);
+    if (atomic_load(&ring->head) == tail && !atomic_load(&ring->finished)) futex_wait(&ring->data_seq, seq);
+    atomic_store(&ring->consumer_waiting, 0);
+}
+
+static void release(shm_ring_t* ring, uint64_t tail)
+{
+    atomic_store(&ring->tail, tail);
+    atomic_fetch_add(&ring->space_seq, 1);
+    if (atomic_load(&ring->producer_waiting)) futex_wake_all(&ring->space_seq);
+}
+
+static const char* deliver(const ingest_sink_t* sink, const char* data, size_t len, unsigned flags)
+{
+    // Hold the ring back while this process's queues exceed the budget
+    mem_budget_wait(sink->budget, mem_budget_item_size(len));
+    // The ring slot is reused once released, so the stage must copy: no CP_ITEM_BORROWED
+    if (sink->place_slice) return sink->place_slice(data, len, flags & CP_ITEM_CHUNK_MASK);
+    return sink->place_work(data);
+}
+
+const char* shm_ring_feed(shm_ring_t* ring, const ingest_sink_t* sink)
+{
+    if (!ring || !sink || !sink->place_work) return "Invalid parameters";
+    atomic_store(&ring->consumer_ready, 1);
+
+    const char* error = NULL;
+    char* joined = NULL;        // pieces of a record longer than SHM_RING_PIECE
+    size_t joined_len = 0;
+    size_t joined_cap = 0;
+    int joining = 0;
+    uint64_t tail = atomic_load(&ring->tail);
+    for (;;)
+    {
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (head == tail)
+        {
+            // finished is set after the last publish, so re-read head once it is seen
+            if (atomic_load(&ring->finished) && atomic_load(&ring->head) == tail) break;
+            wait_data(ring, tail);
+            continue;
+        }
+
+        size_t pos = (size_t)(tail & SHM_RING_MASK);
+        shm_rec_t rec;
+        memcpy(&rec, ring->data + pos, sizeof(rec));
+        if (rec.flags & SHM_REC_PAD)
+        {
+            tail += rec.len;
+            release(ring, tail);
+            continue;
+        }
+        const char* payload = (const char*)ring->data + pos + sizeof(rec);
+        const char* stage_error = NULL;
+
+        if (!(rec.flags & (SHM_REC_MORE | SHM_REC_CONT)))
+        {
+            // A whole record: hand it over in place. A join left open means its producer was restarted.
+            joining = 0;
+            stage_error = deliver(sink, payload, rec.len, rec.flags);
+        }
+        else if (!(rec.flags & SHM_REC_CONT) || joining)
+        {
+            if (!(rec.flags & SHM_REC_CONT)) joined_len = 0;
+            if (joined_len + rec.len + 1 > joined_cap)
+            {
+                size_t cap = (joined_len + rec.len + 1) * 2;
+                char* grown = realloc(joined, cap);
+                if (!grown)
+                {
+                    stage_error = "Memory allocation failed";
+                    joining = 0;
+                }
+                else
+                {
+                    joined = grown;
+                    joined_cap = cap;
+                }
+            }
+            if (!stage_error)
+            {
+                memcpy(joined + joined_len, payload, rec.len);
+                joined_len += rec.len;
+                joined[joined_len] = '\0';
+                joining = (rec.flags & SHM_REC_MORE) != 0;
+                if (!joining) stage_error = deliver(sink, joined, joined_len, rec.flags);
+            }
+        }
+        // else: the rest of a record whose start went to a process that died; skip it
+
+        if (stage_error && !error) error = stage_error;
+        tail += record_size(rec.len);
+        release(ring, tail);
+    }
+    free(joined);
+
+    const char* end_error = sink->place_work(SENTINEL_END);
+    return error ? error : end_error;
+}
@@ -0,0 +1,115 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ingest.h"
+
+#define SHM_RING_BYTES (1u << 20)               /* data area per link, power of two */
+#define SHM_RING_PIECE (SHM_RING_BYTES / 4)     /* longer records cross in several pieces */
+
+/**
+ * Single-producer, single-consumer record ring in a shared memory mapping,
+ * linking two stage processes. Records carry their CP_ITEM_CHUNK_* flags and
+ * the producer's "<END>" becomes the finished signal, so the ring behaves
+ * like a consumer_producer_t queue between processes. Both sides sleep on
+ * process-shared futexes in the mapping. Only the head and tail counters
+ * move data ownership, so a process dying mid-operation leaves the ring
+ * consistent for its replacement.
+ */
+typedef struct
+{
+    _Alignas(64) atomic_uint_least64_t head;    /* Bytes published by the producer */
+    atomic_uint data_seq;                       /* Futex word bumped on publish and finish */
+    atomic_int consumer_waiting;                /* Consumer is parked on data_seq */
+    atomic_int finished;                        /* No more records will be published */
+    atomic_ulong records;                       /* Records published */
+
+    _Alignas(64) atomic_uint_least64_t tail;    /* Bytes released by the consumer */
+    atomic_uint space_seq;                      /* Futex word bumped when room frees up */
+    atomic_int producer_waiting;                /* Producer is parked on space_seq */
+    atomic_int consumer_ready;                  /* Consuming process finished initialization */
+    atomic_int consumer_gone;                   /* Consumer was abandoned; puts fail */
+    atomic_ulong refused;                       /* Records refused after the consumer was abandoned */
+
+    _Alignas(64) unsigned char data[SHM_RING_BYTES];
+} shm_ring_t;
+
+/**
+ * Create an empty ring backed by a memfd that child processes inherit
+ * @param fd  Receives the memfd (not close-on-exec)
+ * @return  Mapped ring, or NULL on failure
+ */
+shm_ring_t* shm_ring_create(int* fd);
+
+/**
+ * Map a ring created by another process
+ * @param fd  Inherited memfd
+ * @return  Mapped ring, or NULL on failure
+ */
+shm_ring_t* shm_ring_map(int fd);
+
+/**
+ * Unmap a ring (the memfd stays open)
+ * @param ring  Mapped ring
+ */
+void shm_ring_unmap(shm_ring_t* ring);
+
+/**
+ * Publish one record, waiting for room. Records longer than SHM_RING_PIECE
+ * are split into pieces that the consumer joins again.
+ * @param ring  Mapped ring
+ * @param data  Record bytes
+ * @param len  Number of bytes
+ * @param flags  CP_ITEM_CHUNK_* bits to hand to the consumer; other bits are ignored
+ * @return  NULL on success, error message if the consumer was abandoned
+ */
+const char* shm_ring_put(shm_ring_t* ring, const char* data, size_t len, unsigned flags);
+
+/**
+ * Signal that no more records follow and wake the consumer. Idempotent.
+ * @param ring  Mapped ring
+ */
+void shm_ring_finish(shm_ring_t* ring);
+
+/**
+ * Give up on the consumer: pending and later puts fail instead of waiting
+ * @param ring  Mapped ring
+ */
+void shm_ring_abandon(shm_ring_t* ring);
+
+/**
+ * Select the ring written by shm_ring_place_work and shm_ring_place_slice
+ * @param ring  Mapped ring, NULL to detach
+ */
+void shm_ring_bind_output(shm_ring_t* ring);
+
+/**
+ * Stage entry point writing to the bound ring; "<END>" finishes it
+ * @param str  NUL-terminated record
+ * @return  NULL on success, error message on failure
+ */
+const char* shm_ring_place_work(const char* str);
+
+/**
+ * Length-aware stage entry point writing to the bound ring; an unchunked
+ * "<END>" finishes it
+ * @param data  Record bytes
+ * @param len  Number of bytes
+ * @param flags  CP_ITEM_* flags
+ * @return  NULL on success, error message on failure
+ */
+const char* shm_ring_place_slice(const char* data, size_t len, unsigned flags);
+
+/**
+ * Consume records until the ring is finished and empty, handing each to the
+ * sink, then send "<END>" to it. Marks the ring ready first. Keeps draining
+ * after a sink error so the producer never blocks on a dead link.
+ * @param ring  Mapped ring
+ * @param sink  First stage of this process
+ * @return  NULL on success, the first sink error otherwise
+ */
+const char* shm_ring_feed(shm_ring_t* ring, const ingest_sink_t* sink);
+
+#endif // SHM_RING_H
@@ -7,6 +7,21 @@
 #include <limits.h>
 #include <link.h>
 #include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include "mem_budget.h"
+#include "scheduler.h"
+#include "ingest.h"
+#include "server.h"
+#include "trace.h"
+#include "log_ring.h"
+#include "perf_counters.h"
+#include "isolate.h"
+#include "shm_ring.h"
+
+// Items a pooled stage may process per scheduling turn before yielding
+#define STAGE_BATCH 64
 
 // Plugin function type definitions 
 typedef const char* (*plugin_init_func_t)(int);
@@ -14,6 +29,16 @@ typedef const char* (*plugin_fini_func_t)(void);
 typedef const char* (*plugin_place_work_func_t)(const char*);
 typedef void        (*plugin_attach_func_t)(plugin_place_work_func_t);
 typedef const char* (*plugin_wait_finished_func_t)(void);
+typedef const char* (*plugin_configure_func_t)(const char*, const char*);
+typedef void        (*plugin_set_budget_func_t)(mem_budget_t*);
+typedef void        (*plugin_set_wakeup_func_t)(void (*)(void*), void*);
+typedef int         (*plugin_run_func_t)(int);
+typedef int         (*plugin_queue_space_func_t)(void);
+typedef const char* (*plugin_place_slice_func_t)(const char*, size_t, unsigned);
+typedef void        (*plugin_attach_slice_func_t)(plugin_place_slice_func_t);
+typedef void        (*plugin_set_trace_func_t)(trace_t*, int);
+typedef void        (*plugin_set_counters_func_t)(perf_counters_t*, int);
+typedef void        (*plugin_set_log_func_t)(log_ring_t*);
 
 // Plugin handle structure
 typedef struct 
@@ -23,28 +48,96 @@ typedef struct
     plugin_place_work_func_t place_work;
     plugin_attach_func_t attach;
     plugin_wait_finished_func_t wait_finished;
+    plugin_configure_func_t configure;   // optional, NULL if not exported
+    plugin_set_budget_func_t set_budget; // optional
+    plugin_set_wakeup_func_t set_wakeup; // optional, scheduler mode
+    plugin_run_func_t run;               // optional, scheduler mode
+    plugin_queue_space_func_t queue_space; // optional, scheduler mode
+    plugin_place_slice_func_t place_slice;   // optional, length-delimited records
+    plugin_attach_slice_func_t attach_slice; // optional
+    plugin_set_trace_func_t set_trace;       // optional, --trace
+    plugin_set_counters_func_t set_counters; // optional, --perf-counters
+    plugin_set_log_func_t set_log;           // optional, shared log ring
     char* name;
     void* handle;
+    int queue_size;                      // per-stage capacity from "name@N", 0 = global default
 } plugin_handle_t;
 
+// A pipeline stage as seen by the pool scheduler
+typedef struct stage_task
+{
+    plugin_handle_t* plugin;
+    struct stage_task* prev;    // upstream stage, NULL for the first
+    struct stage_task* next;    // downstream stage, NULL for the last
+    int index;
+    atomic_int blocked;         // parked because the downstream queue was full
+    scheduler_t* sched;
+} stage_task_t;
+
 // Function to print usage information
 void print_usage(void) 
 {
-    printf("Usage: ./analyzer <queue_size> <plugin1> <plugin2> ... <pluginN>\n\n");
+    printf("Usage: ./analyzer [options] <queue_size> <plugin1> <plugin2> ... <pluginN>\n\n");
+    printf("Options:\n");
+    printf("  --memory-limit SIZE   Byte budget shared by all queues (suffix K, M or G);\n");
+    printf("                        input is held back while the budget is exhausted\n");
+    printf("  --scheduler MODE      thread: one consumer thread per stage (default)\n");
+    printf("                        pool: stages run as tasks on a work-stealing worker pool\n");
+    printf("  --workers N           Pool size for --scheduler pool (default: CPU count)\n");
+    printf("  --handoff MODE        queue: always enqueue between stages (default)\n");
+    printf("                        inline: run an idle stage's work on the producer thread\n");
+    printf("  --io MODE             sync: line-by-line stdin, logger writes with write() (default)\n");
+    printf("                        uring: large stdin reads kept in flight and logger writes\n");
+    printf("                        submitted through io_uring; read()/write() if unavailable\n");
+    printf("  --framing MODE        lines: newline-delimited text (default)\n");
+    printf("                        varint: each record is a LEB128 length followed by that many\n");
+    printf("                        bytes, for input and logger output; end of input ends the run\n");
+    printf("  --chunk-size SIZE     Split records longer than SIZE (suffix K, M or G) into chunks\n");
+    printf("                        that stream through the stages (default: never split)\n");
+    printf("  --listen ADDRESS      Serve local producers instead of reading stdin:\n");
+    printf("                        unix:PATH or tcp:PORT (127.0.0.1); runs until SIGINT/SIGTERM\n");
+    printf("  --input FILE          Read lines from FILE (memory-mapped, no line length limit)\n");
+    printf("                        instead of stdin; <END> is implied at end of file\n");
+    printf("  --isolate GROUPS      Run stages in separate processes linked by shared-memory rings:\n");
+    printf("                        'stage' for one process per stage, or group sizes like 2,1;\n");
+    printf("                        a crashed stage process is restarted\n");
+    printf("  --trace FILE          Record stage processing and queue waits, written to FILE as\n");
+    printf("                        Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev)\n");
+    printf("  --perf-counters MODE  Report CPU time, cycles and cache misses per line, IPC, context\n");
+    printf("                        switches and page faults of every stage thread at shutdown;\n");
+    printf("                        auto: hardware counters where permitted, software: software only\n\n");
     printf("Arguments:\n");
     printf("  queue_size    Maximum number of items in each plugin's queue\n");
     printf("  plugin1..N    Names of plugins to load (without .so extension)\n\n");
+    printf("Stage options:\n");
+    printf("  name[@capacity|@auto][:key=value[,key=value...]]\n");
+    printf("  @capacity                                    Queue size for this stage instead of queue_size\n");
+    printf("  @auto                                        Adaptive queue starting at queue_size\n");
+    printf("  policy=block|drop-newest|drop-oldest|spill   Behaviour when the stage queue is full\n");
+    printf("  min_capacity=N,max_capacity=N                Bounds for adaptive queues\n");
+    printf("  handoff=queue|inline                         Per-stage override of --handoff\n");
+    printf("  cache=N                                      Memoize up to N results of a deterministic stage\n\n");
     printf("Available plugins:\n");
     printf("  logger        - Logs all strings that pass through\n");
     printf("  typewriter    - Simulates typewriter effect with delays\n");
     printf("  uppercaser    - Converts strings to uppercase\n");
     printf("  rotator       - Move every character to the right. Last character moves to the beginning.\n");
     printf("  flipper       - Reverses the order of characters\n");
-    printf("  expander      - Expands each character with spaces\n\n");
+    printf("  expander      - Expands each character with spaces\n");
+    printf("  filter        - Keeps (mode=keep) or drops (mode=drop) lines matching match=PAT|PAT...\n");
+    printf("  topk          - Reports the k=N most frequent lines (token=word: words) at <END> or every=N lines\n\n");
     printf("Example:\n");
     printf("  ./analyzer 20 uppercaser rotator logger\n");
     printf("  echo 'hello' | ./analyzer 20 uppercaser rotator logger\n");
     printf("  echo '<END>' | ./analyzer 20 uppercaser rotator logger\n");
+    printf("  ./analyzer 20 uppercaser logger:policy=spill\n");
+    printf("  ./analyzer 20 'filter:match=ERROR|^GET |.html$,mode=drop' logger\n");
+    printf("  ./analyzer 20 uppercaser@4 typewriter@4096 logger@auto:max_capacity=1024\n");
+    printf("  ./analyzer --input access.log 64 uppercaser logger\n");
+    printf("  ./analyzer --listen unix:/tmp/analyzer.sock 64 uppercaser logger\n");
+    printf("  ./analyzer --trace trace.json 64 uppercaser flipper logger < input.txt\n");
+    printf("  ./analyzer --isolate stage 64 uppercaser flipper logger < input.txt\n");
+    printf("  ./analyzer --perf-counters auto 64 uppercaser flipper logger < input.txt\n");
 }
 
 static int check_dlerror(const char *symname, void *handle, plugin_handle_t* plugin) {
@@ -112,13 +205,180 @@ static plugin_handle_t* load_plugin(const char* plugin_name)
     plugin->wait_finished = (plugin_wait_finished_func_t)dlsym(handle, "plugin_wait_finished");
     if (check_dlerror("plugin_wait_finished", handle, plugin)) return NULL;
 
+    // Optional symbols: absence is not an error
+    plugin->configure = (plugin_configure_func_t)dlsym(handle, "plugin_configure");
+    plugin->set_budget = (plugin_set_budget_func_t)dlsym(handle, "plugin_set_budget");
+    plugin->set_wakeup = (plugin_set_wakeup_func_t)dlsym(handle, "plugin_set_wakeup");
+    plugin->run = (plugin_run_func_t)dlsym(handle, "plugin_run");
+    plugin->queue_space = (plugin_queue_space_func_t)dlsym(handle, "plugin_queue_space");
+    plugin->place_slice = (plugin_place_slice_func_t)dlsym(handle, "plugin_place_slice");
+    plugin->attach_slice = (plugin_attach_slice_func_t)dlsym(handle, "plugin_attach_slice");
+    plugin->set_trace = (plugin_set_trace_func_t)dlsym(handle, "plugin_set_trace");
+    plugin->set_counters = (plugin_set_counters_func_t)dlsym(handle, "plugin_set_counters");
+    plugin->set_log = (plugin_set_log_func_t)dlsym(handle, "plugin_set_log");
+
     // Store plugin info
     plugin->name = strdup(plugin_name);
     plugin->handle = handle;
+    plugin->queue_size = 0;
     
     return plugin;
 }
 
+// Split "name[@capacity|@auto][:key=value,...]" into its parts.
+// capacity is 0 when not given and STAGE_CAPACITY_AUTO for "@auto".
+#define STAGE_CAPACITY_AUTO (-1)
+static int parse_stage_spec(const char* spec, char* name, size_t name_size, int* capacity, const char** options)
+{
+    const char* colon = strchr(spec, ':');
+    size_t spec_len = colon ? (size_t)(colon - spec) : strlen(spec);
+    const char* at = memchr(spec, '@', spec_len);
+    size_t len = at ? (size_t)(at - spec) : spec_len;
+    if (len == 0 || len >= name_size) return -1;
+
+    memcpy(name, spec, len);
+    name[len] = '\0';
+    *options = colon ? colon + 1 : NULL;
+    *capacity = 0;
+
+    if (at)
+    {
+        char size[32];
+        size_t size_len = spec_len - len - 1;
+        if (size_len == 0 || size_len >= sizeof(size)) return -1;
+        memcpy(size, at + 1, size_len);
+        size[size_len] = '\0';
+
+        if (strcmp(size, "auto") == 0)
+        {
+            *capacity = STAGE_CAPACITY_AUTO;
+            return 0;
+        }
+        char* end;
+        errno = 0;
+        long q = strtol(size, &end, 10);
+        if (errno == ERANGE || *end != '\0' || q < 1 || q > INT_MAX) return -1;
+        *capacity = (int)q;
+    }
+    return 0;
+}
+
+// Apply a comma separated key=value list through the plugin's plugin_configure
+static int configure_stage(plugin_handle_t* plugin, const char* options)
+{
+    if (!options || !*options) return 0;
+    if (!plugin->configure)
+    {
+        fprintf(stderr, "Plugin %s does not accept options\n", plugin->name);
+        return -1;
+    }
+
+    char* list = strdup(options);
+    if (!list) return -1;
+
+    int rc = 0;
+    char* saveptr = NULL;
+    for (char* tok = strtok_r(list, ",", &saveptr); tok; tok = strtok_r(NULL, ",", &saveptr))
+    {
+        char* eq = strchr(tok, '=');
+        if (!eq || eq == tok)
+        {
+            fprintf(stderr, "Invalid option '%s' for plugin %s (expected key=value)\n", tok, plugin->name);
+            rc = -1;
+            break;
+        }
+        *eq = '\0';
+        const char* error = plugin->configure(tok, eq + 1);
+        if (error)
+        {
+            fprintf(stderr, "Invalid option %s=%s for plugin %s: %s\n", tok, eq + 1, plugin->name, error);
+            rc = -1;
+            break;
+        }
+    }
+    free(list);
+    return rc;
+}
+
+// Parse a byte count with an optional K/M/G suffix
+static int parse_size(const char* text, size_t* out)
+{
+    char* end;
+    errno = 0;
+    unsigned long long v = strtoull(text, &end, 10);
+    if (errno == ERANGE || end == text || text[0] == '-') return -1;
+
+    unsigned long long mult = 1;
+    if (*end == 'K' || *end == 'k') mult = 1ULL << 10;
+    else if (*end == 'M' || *end == 'm') mult = 1ULL << 20;
+    else if (*end == 'G' || *end == 'g') mult = 1ULL << 30;
+    if (mult != 1) end++;
+    if (*end != '\0' || v == 0 || v > SIZE_MAX / mult) return -1;
+
+    *out = (size_t)(v * mult);
+    return 0;
+}
+
+// Wake hook handed to plugins in pool mode: work or the finished signal arrived
+static void stage_wake(void* arg)
+{
+    stage_task_t* task = arg;
+    // No scheduler while startup is being undone; stop_unstarted runs the stage itself
+    if (task->sched) scheduler_wake(task->sched, task->index);
+}
+
+// Scheduler task body: run one batch of a stage without overfilling its downstream queue.
+// plugin_run forwards at most as many records as the free downstream slots it is given
+// (a plugin emitting extra records holds them back), so next_place_work never blocks a
+// pool worker.
+static sched_status_t run_stage(void* arg)
+{
+    stage_task_t* task = arg;
+
+    int budget = STAGE_BATCH;
+    if (task->next)
+    {
+        int space = task->next->plugin->queue_space();
+        if (space < budget) budget = space;
+        if (budget <= 0)
+        {
+            // Park until the downstream stage drains; recheck to close the race with it
+            atomic_store(&task->blocked, 1);
+            if (task->next->plugin->queue_space() <= 0) return SCHED_TASK_IDLE;
+            atomic_store(&task->blocked, 0);
+            return SCHED_TASK_AGAIN;
+        }
+    }
+
+    int processed = task->plugin->run(budget);
+    if (processed < 0) return SCHED_TASK_DONE;
+
+    // We freed queue slots: release an upstream stage parked on us
+    if (processed > 0 && task->prev && atomic_exchange(&task->prev->blocked, 0))
+    {
+        scheduler_wake(task->sched, task->prev->index);
+    }
+    return processed == budget ? SCHED_TASK_AGAIN : SCHED_TASK_IDLE;
+}
+
+// Undo a failed startup: end the first count stages, which are initialized but were never
+// fed, so plugin_fini can join them. Links are cut first so every stage sees one <END>.
+// Pool stages have no scheduler yet and are run to completion on this thread.
+static void stop_unstarted(plugin_handle_t** plugins, stage_task_t* tasks, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        plugins[i]->attach(NULL);
+        if (tasks) tasks[i].sched = NULL;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        const char* error = plugins[i]->place_work("<END>");
+        if (error) fprintf(stderr, "Error stopping plugin %s: %s\n", plugins[i]->name, error);
+        while (!error && tasks && plugins[i]->run(STAGE_BATCH) >= 0) {}
+    }
+}
+
 // Function to free a plugin handle
 void free_plugin(plugin_handle_t* plugin) 
 {
@@ -130,32 +390,400 @@ void free_plugin(plugin_handle_t* plugin)
     }
 }
 
+// Split num_stages into process groups: "stage" (one each) or comma separated sizes
+static int parse_groups(const char* spec, int num_stages, int* sizes, int* num_groups)
+{
+    if (strcmp(spec, "stage") == 0)
+    {
+        for (int i = 0; i < num_stages; i++) sizes[i] = 1;
+        *num_groups = num_stages;
+        return 0;
+    }
+
+    int groups = 0, total = 0;
+    const char* p = spec;
+    while (*p)
+    {
+        char* end;
+        errno = 0;
+        long n = strtol(p, &end, 10);
+        if (errno == ERANGE || end == p || n < 1 || n > num_stages - total || groups == num_stages) return -1;
+        sizes[groups++] = (int)n;
+        total += (int)n;
+        if (*end == ',' && end[1]) end++;
+        else if (*end) return -1;
+        p = end;
+    }
+    if (total != num_stages) return -1;
+    *num_groups = groups;
+    return 0;
+}
+
+// --isolate: start a worker process per stage group and feed the first one through
+// its ring. Workers are this binary with --stage-worker and the same options, minus
+// the ones only ingest uses.
+static int run_isolated(char* argv[], int argi, const char* groups_spec, const char* input_path,
+                        const char* listen_address, ingest_io_t io, ingest_framing_t framing, size_t chunk_size)
+{
+    int argc_stages = 0;
+    while (argv[argi + 1 + argc_stages]) argc_stages++;
+    char** stage_args = argv + argi + 1;
+
+    int* sizes = malloc(argc_stages * sizeof(int));
+    char (*names)[128] = malloc(argc_stages * sizeof(*names));
+    const char** name_ptrs = malloc(argc_stages * sizeof(*name_ptrs));
+    char** worker_argv = malloc((argi + argc_stages + 4) * sizeof(char*));
+    if (!sizes || !names || !name_ptrs || !worker_argv)
+    {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        free(sizes);
+        free(names);
+        free(name_ptrs);
+        free(worker_argv);
+        return 1;
+    }
+
+    int rc = 0;
+    int num_groups = 0;
+    for (int i = 0; i < argc_stages && rc == 0; i++)
+    {
+        int capacity;
+        const char* options;
+        if (parse_stage_spec(stage_args[i], names[i], sizeof(names[i]), &capacity, &options) != 0)
+        {
+            fprintf(stderr, "Error: Failed to load plugin %s\n", stage_args[i]);
+            rc = 1;
+        }
+        name_ptrs[i] = names[i];
+    }
+    if (rc == 0 && parse_groups(groups_spec, argc_stages, sizes, &num_groups) != 0)
+    {
+        fprintf(stderr, "Invalid stage groups: '%s'\n", groups_spec);
+        rc = 1;
+    }
+    if (rc != 0)
+    {
+        print_usage();
+        free(sizes);
+        free(names);
+        free(name_ptrs);
+        free(worker_argv);
+        return rc;
+    }
+
+    int n = 0;
+    worker_argv[n++] = argv[0];
+    worker_argv[n++] = "--stage-worker";
+    worker_argv[n++] = NULL;    // set per group by isolate_start
+    for (int i = 1; i < argi; i += 2)
+    {
+        if (strcmp(argv[i], "--isolate") == 0 || strcmp(argv[i], "--input") == 0 ||
+            strcmp(argv[i], "--listen") == 0)
+        {
+            continue;
+        }
+        worker_argv[n++] = argv[i];
+        worker_argv[n++] = argv[i + 1];
+    }
+    for (int i = argi; argv[i]; i++) worker_argv[n++] = argv[i];
+    worker_argv[n] = NULL;
+
+    isolate_t iso;
+    const char* error = isolate_start(&iso, worker_argv, name_ptrs, sizes, num_groups);
+    if (error)
+    {
+        fprintf(stderr, "Error starting stage processes: %s\n", error);
+        free(sizes);
+        free(names);
+        free(name_ptrs);
+        free(worker_argv);
+        return 2;
+    }
+
+    // Ingest is unchanged; the first ring stands in for the first stage
+    shm_ring_t* input_ring = isolate_input(&iso);
+    shm_ring_bind_output(input_ring);
+    ingest_sink_t sink = { shm_ring_place_work, shm_ring_place_slice, NULL, NULL, chunk_size };
+    ingest_file_t input = { -1, NULL, 0 };
+    const char* ingest_error;
+    if (listen_address) ingest_error = ingest_server(listen_address, &sink, framing);
+    else if (input_path)
+    {
+        ingest_error = ingest_file_open(&input, input_path);
+        if (!ingest_error) ingest_error = ingest_file_feed(&input, &sink, framing);
+    }
+    else ingest_error = ingest_stdin(&sink, io, framing);
+    if (ingest_error) fprintf(stderr, "Error placing work: %s\n", ingest_error);
+
+    // The ring copies every record, so the input can go before the stages finish
+    if (input_path) ingest_file_close(&input);
+    shm_ring_finish(input_ring);
+    shm_ring_bind_output(NULL);
+
+    if (isolate_wait(&iso) != 0) rc = 1;
+    isolate_destroy(&iso);
+    free(sizes);
+    free(names);
+    free(name_ptrs);
+    free(worker_argv);
+
+    fprintf(framing == INGEST_FRAMING_VARINT ? stderr : stdout, "Pipeline shutdown complete\n");
+    return rc;
+}
+
 int main(int argc, char* argv[]) 
 {
+    // Parse leading --options
+    size_t memory_limit = 0;
+    int use_pool = 0;
+    int workers = 0;
+    const char* handoff = NULL;
+    const char* input_path = NULL;
+    const char* io_mode = NULL;
+    const char* listen_address = NULL;
+    const char* framing = NULL;
+    const char* trace_path = NULL;
+    const char* isolate_groups = NULL;
+    const char* worker_spec = NULL;
+    const char* perf_mode = NULL;
+    size_t chunk_size = 0;
+    int argi = 1;
+    while (argi < argc && strncmp(argv[argi], "--", 2) == 0)
+    {
+        const char* opt = argv[argi];
+        const char* value = argi + 1 < argc ? argv[argi + 1] : NULL;
+        if (strcmp(opt, "--memory-limit") == 0 && value)
+        {
+            if (parse_size(value, &memory_limit) != 0)
+            {
+                fprintf(stderr, "Invalid memory limit: '%s'\n", value);
+                print_usage();
+                return 1;
+            }
+            argi += 2;
+        }
+        else if (strcmp(opt, "--scheduler") == 0 && value)
+        {
+            if (strcmp(value, "pool") == 0) use_pool = 1;
+            else if (strcmp(value, "thread") == 0) use_pool = 0;
+            else
+            {
+                fprintf(stderr, "Invalid scheduler: '%s'\n", value);
+                print_usage();
+                return 1;
+            }
+            argi += 2;
+        }
+        else if (strcmp(opt, "--handoff") == 0 && value)
+        {
+            if (strcmp(value, "queue") != 0 && strcmp(value, "inline") != 0)
+            {
+                fprintf(stderr, "Invalid handoff mode: '%s'\n", value);
+                print_usage();
+                return 1;
+            }
+            handoff = value;
+            argi += 2;
+        }
+        else if (strcmp(opt, "--io") == 0 && value)
+        {
+            if (strcmp(value, "sync") != 0 && strcmp(value, "uring") != 0)
+            {
+                fprintf(stderr, "Invalid I/O mode: '%s'\n", value);
+                print_usage();
+                return 1;
+            }
+            io_mode = value;
+            argi += 2;
+        }
+        else if (strcmp(opt, "--chunk-size") == 0 && value)
+        {
+            if (parse_size(value, &chunk_size) != 0)
+            {
+                fprintf(stderr, "Invalid chunk size: '%s'\n", value);
+                print_usage();
+                return 1;
+            }
+            argi += 2;
+        }
+        else if (strcmp(opt, "--framing") == 0 && value)
+        {
+            if (strcmp(value, "lines") != 0 && strcmp(value, "varint") != 0)
+            {
+                fprintf(stderr, "Invalid framing: '%s'\n", value);
+                print_usage();
+                return 1;
+            }
+            framing = value;
+            argi += 2;
+        }
+        else if (strcmp(opt, "--listen") == 0 && value)
+        {
+            if (server_parse_check(value) != 0)
+            {
+                fprintf(stderr, "Invalid listen address: '%s'\n", value);
+                print_usage();
+                return 1;
+            }
+            listen_address = value;
+            argi += 2;
+        }
+        else if (strcmp(opt, "--input") == 0 && value)
+        {
+            input_path = value;
+            argi += 2;
+        }
+        else if (strcmp(opt, "--trace") == 0 && value)
+        {
+            trace_path = value;
+            argi += 2;
+        }
+        else if (strcmp(opt, "--perf-counters") == 0 && value)
+        {
+            if (strcmp(value, "auto") != 0 && strcmp(value, "software") != 0)
+            {
+                fprintf(stderr, "Invalid perf counter mode: '%s'\n", value);
+                print_usage();
+                return 1;
+            }
+            perf_mode = value;
+            argi += 2;
+        }
+        else if (strcmp(opt, "--isolate") == 0 && value)
+        {
+            isolate_groups = value;
+            argi += 2;
+        }
+        else if (strcmp(opt, "--stage-worker") == 0 && value)
+        {
+            // Internal: started by --isolate to run one stage group
+            worker_spec = value;
+            argi += 2;
+        }
+        else if (strcmp(opt, "--workers") == 0 && value)
+        {
+            char* wend;
+            errno = 0;
+            long w = strtol(value, &wend, 10);
+            if (errno == ERANGE || *wend != '\0' || w < 1 || w > 4096)
+            {
+                fprintf(stderr, "Invalid worker count: '%s'\n", value);
+                print_usage();
+                return 1;
+            }
+            workers = (int)w;
+            argi += 2;
+        }
+        else
+        {
+            fprintf(stderr, "Error: Unknown or incomplete option '%s'\n", opt);
+            print_usage();
+            return 1;
+        }
+    }
+
     // Check command line arguments
-    if (argc < 3) 
+    if (argc - argi < 2) 
     {
         fprintf(stderr, "Error: Insufficient arguments\n");
         print_usage();
         return 1;
     }
+    if (listen_address && input_path)
+    {
+        fprintf(stderr, "Error: --listen and --input are mutually exclusive\n");
+        print_usage();
+        return 1;
+    }
+    if (isolate_groups && trace_path)
+    {
+        fprintf(stderr, "Error: --trace is not supported with --isolate\n");
+        print_usage();
+        return 1;
+    }
+    if (use_pool && perf_mode)
+    {
+        // Pool workers run many stages each, so counts cannot be charged to one stage
+        fprintf(stderr, "Error: --perf-counters requires --scheduler thread\n");
+        print_usage();
+        return 1;
+    }
+    if (listen_address)
+    {
+        // Threads inherit this mask, so shutdown signals only reach the server's signalfd
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    }
     
     // Parse queue size
     char *end;
     errno = 0;
-    long q = strtol(argv[1], &end, 10);
+    long q = strtol(argv[argi], &end, 10);
 
     if (errno == ERANGE || *end != '\0' || q < 1 || q > INT_MAX) {
-        fprintf(stderr, "Invalid queue size: '%s'\n", argv[1]);
+        fprintf(stderr, "Invalid queue size: '%s'\n", argv[argi]);
         print_usage();
         return 1;
     }
 
     int queue_size = (int)q;
+    char** stage_args = argv + argi + 1;
     
     // Calculate number of plugins
-    int num_plugins = argc - 2;
-    plugin_handle_t** plugins = malloc(num_plugins * sizeof(plugin_handle_t*));
+    int num_plugins = argc - argi - 1;
+
+    ingest_framing_t input_framing = framing && strcmp(framing, "varint") == 0 ? INGEST_FRAMING_VARINT : INGEST_FRAMING_LINES;
+    ingest_io_t input_io = io_mode && strcmp(io_mode, "uring") == 0 ? INGEST_IO_URING : INGEST_IO_SYNC;
+    if (isolate_groups && !worker_spec)
+    {
+        return run_isolated(argv, argi, isolate_groups, input_path, listen_address, input_io, input_framing,
+                            chunk_size);
+    }
+
+    // Worker of --isolate: run only this group's stages between two rings
+    shm_ring_t* in_ring = NULL;
+    shm_ring_t* out_ring = NULL;
+    if (worker_spec)
+    {
+        int in_fd, out_fd, first, count;
+        if (isolate_parse_worker(worker_spec, &in_fd, &out_fd, &first, &count) != 0 || first + count > num_plugins)
+        {
+            fprintf(stderr, "Invalid stage worker: '%s'\n", worker_spec);
+            return 1;
+        }
+        // Do not outlive the analyzer that feeds us
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        if (getppid() == 1) return 1;
+
+        in_ring = shm_ring_map(in_fd);
+        out_ring = out_fd >= 0 ? shm_ring_map(out_fd) : NULL;
+        if (!in_ring || (out_fd >= 0 && !out_ring))
+        {
+            fprintf(stderr, "Error: Failed to map stage rings\n");
+            return 1;
+        }
+        stage_args += first;
+        num_plugins = count;
+    }
+    // Everything below is released once, in reverse order of setup, at cleanup
+    int rc = 0;
+    int num_initialized = 0;    // stages whose plugin_init succeeded
+    int finished = 0;           // every stage has seen <END> and finished
+    mem_budget_t budget;
+    mem_budget_t* shared_budget = NULL;
+    trace_t* trace = NULL;
+    perf_counters_t counters;
+    perf_counters_t* shared_counters = NULL;
+    scheduler_t sched;
+    int sched_started = 0;
+    stage_task_t* tasks = NULL;
+    void** task_args = NULL;
+    log_ring_t* shared_log = NULL;
+
+    plugin_handle_t** plugins = calloc(num_plugins, sizeof(plugin_handle_t*));
     if (!plugins) 
     {
         fprintf(stderr, "Error: Memory allocation failed\n");
@@ -165,83 +793,344 @@ int main(int argc, char* argv[])
     // Load all plugins
     for (int i = 0; i < num_plugins; i++) 
     {
-        plugins[i] = load_plugin(argv[i + 2]);
-        if (!plugins[i]) 
+        char name[128];
+        const char* options = NULL;
+        int capacity = 0;
+        if (parse_stage_spec(stage_args[i], name, sizeof(name), &capacity, &options) == 0) plugins[i] = load_plugin(name);
+        else plugins[i] = NULL;
+
+        int failed = !plugins[i];
+        if (!failed && capacity == STAGE_CAPACITY_AUTO)
         {
-            fprintf(stderr, "Error: Failed to load plugin %s\n", argv[i + 2]);
-            // Clean up already loaded plugins
-            for (int j = 0; j < i; j++) free_plugin(plugins[j]);
-            free(plugins);
+            // "@auto" is shorthand for the adaptive stage option
+            const char* error = plugins[i]->configure ? plugins[i]->configure("adaptive", "on")
+                                                      : "plugin_configure not exported";
+            if (error)
+            {
+                fprintf(stderr, "Plugin %s cannot use adaptive sizing: %s\n", name, error);
+                failed = 1;
+            }
+        }
+        else if (!failed) plugins[i]->queue_size = capacity;
+
+        // Global defaults go first so per-stage options can override them
+        if (!failed && handoff)
+        {
+            const char* error = plugins[i]->configure ? plugins[i]->configure("handoff", handoff)
+                                                      : "plugin_configure not exported";
+            if (error)
+            {
+                fprintf(stderr, "Plugin %s cannot use --handoff: %s\n", name, error);
+                failed = 1;
+            }
+        }
+        if (!failed && framing)
+        {
+            const char* error = plugins[i]->configure ? plugins[i]->configure("framing", framing)
+                                                      : "plugin_configure not exported";
+            if (error)
+            {
+                fprintf(stderr, "Plugin %s cannot use --framing: %s\n", name, error);
+                failed = 1;
+            }
+        }
+        if (!failed && io_mode)
+        {
+            const char* error = plugins[i]->configure ? plugins[i]->configure("io", io_mode)
+                                                      : "plugin_configure not exported";
+            if (error)
+            {
+                fprintf(stderr, "Plugin %s cannot use --io: %s\n", name, error);
+                failed = 1;
+            }
+        }
+
+        if (failed || configure_stage(plugins[i], options) != 0) 
+        {
+            fprintf(stderr, "Error: Failed to load plugin %s\n", stage_args[i]);
             print_usage();
-            return 1;
+            rc = 1;
+            goto cleanup;
+        }
+    }
+    
+    // Chunks only make sense if every link carries their flags
+    for (int i = 0; chunk_size > 0 && i < num_plugins; i++)
+    {
+        if (!plugins[i]->place_slice || !plugins[i]->attach_slice)
+        {
+            // Ingest in the parent process already splits records for a worker
+            if (worker_spec)
+            {
+                fprintf(stderr, "Error: plugin %s does not support chunked records (--chunk-size)\n", plugins[i]->name);
+                rc = 1;
+                goto cleanup;
+            }
+            fprintf(stderr, "Warning: plugin %s does not support chunked records, --chunk-size ignored\n", plugins[i]->name);
+            chunk_size = 0;
+        }
+    }
+
+    // Pipeline-wide byte budget shared by every stage queue
+    if (memory_limit > 0)
+    {
+        if (mem_budget_init(&budget, memory_limit) != 0)
+        {
+            fprintf(stderr, "Error: Failed to initialize memory budget\n");
+            rc = 1;
+            goto cleanup;
+        }
+        shared_budget = &budget;
+        for (int i = 0; i < num_plugins; i++)
+        {
+            if (plugins[i]->set_budget) plugins[i]->set_budget(shared_budget);
+            else fprintf(stderr, "Warning: plugin %s does not support memory accounting\n", plugins[i]->name);
+        }
+    }
+    
+    // Execution trace: every stage records into buffers owned here
+    if (trace_path)
+    {
+        trace = malloc(sizeof(*trace));
+        if (!trace)
+        {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            rc = 1;
+            goto cleanup;
+        }
+        trace_init(trace);
+        trace_attach(trace, -1);
+        trace_thread_label("ingest");
+        for (int i = 0; i < num_plugins; i++)
+        {
+            if (plugins[i]->set_trace) plugins[i]->set_trace(trace, i);
+            else fprintf(stderr, "Warning: plugin %s does not support tracing\n", plugins[i]->name);
+        }
+    }
+
+    // Per-stage counters: every consumer thread adds its counts to totals owned here
+    if (perf_mode)
+    {
+        const char* error = perf_counters_init(&counters, num_plugins, strcmp(perf_mode, "software") == 0);
+        if (error)
+        {
+            fprintf(stderr, "Error: Failed to initialize perf counters: %s\n", error);
+            rc = 1;
+            goto cleanup;
+        }
+        shared_counters = &counters;
+        for (int i = 0; i < num_plugins; i++)
+        {
+            if (plugins[i]->set_counters) plugins[i]->set_counters(shared_counters, i);
+            else fprintf(stderr, "Warning: plugin %s does not support perf counters\n", plugins[i]->name);
+        }
+    }
+    
+    // Pool mode: stages become scheduler tasks instead of owning a thread each
+    if (use_pool)
+    {
+        tasks = calloc(num_plugins, sizeof(stage_task_t));
+        task_args = calloc(num_plugins, sizeof(void*));
+        int supported = tasks && task_args;
+        for (int i = 0; supported && i < num_plugins; i++)
+        {
+            if (!plugins[i]->set_wakeup || !plugins[i]->run || !plugins[i]->queue_space)
+            {
+                fprintf(stderr, "Error: plugin %s does not support --scheduler pool\n", plugins[i]->name);
+                supported = 0;
+            }
+        }
+        if (!supported)
+        {
+            rc = 1;
+            goto cleanup;
+        }
+        for (int i = 0; i < num_plugins; i++)
+        {
+            tasks[i].plugin = plugins[i];
+            tasks[i].prev = i > 0 ? &tasks[i - 1] : NULL;
+            tasks[i].next = i + 1 < num_plugins ? &tasks[i + 1] : NULL;
+            tasks[i].index = i;
+            atomic_init(&tasks[i].blocked, 0);
+            tasks[i].sched = &sched;
+            task_args[i] = &tasks[i];
+            plugins[i]->set_wakeup(stage_wake, &tasks[i]);
         }
     }
     
+    // One log drain thread for the whole pipeline; a plugin without plugin_set_log starts its own
+    shared_log = malloc(sizeof(*shared_log));
+    if (shared_log && log_ring_start(shared_log, "analyzer") != NULL)
+    {
+        free(shared_log);
+        shared_log = NULL;
+    }
+    for (int i = 0; shared_log && i < num_plugins; i++)
+    {
+        if (plugins[i]->set_log) plugins[i]->set_log(shared_log);
+    }
+
     // Initialize all plugins
     for (int i = 0; i < num_plugins; i++) 
     {
-        const char* error = plugins[i]->init(queue_size);
+        int stage_queue_size = plugins[i]->queue_size > 0 ? plugins[i]->queue_size : queue_size;
+        const char* error = plugins[i]->init(stage_queue_size);
         
         if (error) 
         {
             fprintf(stderr, "Error initializing plugin %s: %s\n", plugins[i]->name, error ? error : "Unknown error");
-            // Clean up if plugin init fails
-            for (int j = 0; j <= i; j++) 
-            {
-                if (j < i) plugins[j]->fini();
-                free_plugin(plugins[j]);
-            }
-            free(plugins);
-            return 2;
+            rc = 2;
+            goto cleanup;
         }
+        num_initialized++;
     }
     
-    // Attach plugins together
+    // Attach plugins together; length-aware links keep borrowed records zero-copy
     for (int i = 0; i < num_plugins - 1; i++) 
     {
         plugins[i]->attach(plugins[i+1]->place_work);
+        if (plugins[i]->attach_slice && plugins[i+1]->place_slice) plugins[i]->attach_slice(plugins[i+1]->place_slice);
     }
     
-    // Detach last plugin from any next plugin
-    if (num_plugins > 0) plugins[num_plugins - 1]->attach(NULL);
-    
-    // Read input from STDIN and feed to first plugin
-    char line[1025]; // 1024 chars + null terminator
-    while (fgets(line, sizeof(line), stdin)) 
+    // Detach last plugin from any next plugin, or link it to the next stage process
+    if (out_ring)
     {
-        // Remove trailing newline
-        size_t len = strlen(line);
-        if (len > 0 && line[len - 1] == '\n') line[len - 1] = '\0';
+        shm_ring_bind_output(out_ring);
+        plugins[num_plugins - 1]->attach(shm_ring_place_work);
+        if (plugins[num_plugins - 1]->attach_slice) plugins[num_plugins - 1]->attach_slice(shm_ring_place_slice);
+    }
+    else if (num_plugins > 0) plugins[num_plugins - 1]->attach(NULL);
 
-        // Send to first plugin
-        const char* error = plugins[0]->place_work(line);
-        if (error) 
+    if (use_pool)
+    {
+        if (workers == 0) workers = scheduler_cpu_count();
+        if (workers > num_plugins) workers = num_plugins;
+        const char* error = scheduler_init(&sched, workers, num_plugins, run_stage, task_args);
+        if (error)
         {
-            fprintf(stderr, "Error placing work: %s\n", error);
-            break;
+            fprintf(stderr, "Error starting scheduler: %s\n", error);
+            rc = 2;
+            goto cleanup;
         }
-        // Check for END signal and exit loop
-        if (strcmp(line, "<END>") == 0) break;
+        sched_started = 1;
     }
     
+    // Feed input to the first plugin
+    ingest_sink_t sink = { plugins[0]->place_work, plugins[0]->place_slice, shared_budget, plugins[0]->queue_space,
+                           chunk_size };
+    ingest_file_t input = { -1, NULL, 0 };
+    const char* ingest_error = NULL;
+    if (in_ring)
+    {
+        ingest_error = shm_ring_feed(in_ring, &sink);
+    }
+    else if (listen_address)
+    {
+        ingest_error = ingest_server(listen_address, &sink, input_framing);
+    }
+    else if (input_path)
+    {
+        ingest_error = ingest_file_open(&input, input_path);
+        // Still finish the pipeline so every stage shuts down cleanly
+        if (ingest_error) plugins[0]->place_work("<END>");
+        else ingest_error = ingest_file_feed(&input, &sink, input_framing);
+    }
+    else
+    {
+        ingest_error = ingest_stdin(&sink, input_io, input_framing);
+    }
+    if (ingest_error) fprintf(stderr, "Error placing work: %s\n", ingest_error);
     
     for (int i = 0; i < num_plugins; i++) 
     {
         const char* error = plugins[i]->wait_finished();
         if (error) fprintf(stderr, "Error waiting for plugin %s to finish: %s\n", plugins[i]->name, error);
     }
+    finished = 1;
     
+    // Stages may still hold slices of the input mapping until they have finished
+    if (input_path) ingest_file_close(&input);
+
+cleanup:
+    // Stages that were initialized but never fed still need an <END> before they can be joined
+    if (!finished) stop_unstarted(plugins, tasks, num_initialized);
+    if (sched_started) scheduler_destroy(&sched);
+
     // Finalize all plugins - this will wait for their threads to complete
-    for (int i = 0; i < num_plugins; i++) 
+    for (int i = 0; i < num_initialized; i++) 
     {
         const char* error = plugins[i]->fini();
         if (error) fprintf(stderr, "Error finalizing plugin %s: %s\n", plugins[i]->name, error);
     }
-    
-    // Clean up
+
+    // Stages have logged their summaries; write them out and stop the drain thread
+    if (shared_log) log_ring_stop(shared_log);
+    free(shared_log);
+    free(task_args);
+    free(tasks);
+
+    // Every consumer thread has added its counts by now
+    if (shared_counters)
+    {
+        if (finished)
+        {
+            const char** names = malloc(num_plugins * sizeof(*names));
+            if (names)
+            {
+                for (int i = 0; i < num_plugins; i++) names[i] = plugins[i]->name;
+                perf_counters_report(shared_counters, names);
+            }
+            else fprintf(stderr, "Error reporting perf counters: Memory allocation failed\n");
+            free(names);
+        }
+        perf_counters_destroy(shared_counters);
+    }
+
+    // Every traced thread has been joined by now
+    if (trace)
+    {
+        if (finished)
+        {
+            const char** names = malloc(num_plugins * sizeof(*names));
+            const char* error = names ? NULL : "Memory allocation failed";
+            for (int i = 0; names && i < num_plugins; i++) names[i] = plugins[i]->name;
+            if (!error) error = trace_write_json(trace, trace_path, names, num_plugins);
+            if (error) fprintf(stderr, "Error writing trace %s: %s\n", trace_path, error);
+            else
+            {
+                unsigned long dropped = 0;
+                size_t events = trace_event_count(trace, &dropped);
+                fprintf(stderr, "Trace: %zu events written to %s, %lu dropped\n", events, trace_path, dropped);
+            }
+            free(names);
+        }
+        trace_attach(NULL, -1);
+        trace_destroy(trace);
+        free(trace);
+    }
+
+    if (shared_budget)
+    {
+        if (finished)
+        {
+            fprintf(stderr, "Memory budget: peak %zu of %zu bytes, ingest waited %lu times\n",
+                    atomic_load(&shared_budget->peak), shared_budget->limit,
+                    atomic_load(&shared_budget->ingest_waits));
+        }
+        mem_budget_destroy(shared_budget);
+    }
+
     for (int i = 0; i < num_plugins; i++) free_plugin(plugins[i]);
     free(plugins);
     
-    printf("Pipeline shutdown complete\n");
-    return 0;
-} 
\ No newline at end of file
+    if (worker_spec)
+    {
+        shm_ring_unmap(in_ring);
+        shm_ring_unmap(out_ring);
+        return rc;
+    }
+
+    // Keep a framed stdout free of text
+    if (finished) fprintf(input_framing == INGEST_FRAMING_VARINT ? stderr : stdout, "Pipeline shutdown complete\n");
+    return rc;
+}
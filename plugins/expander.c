@@ -2,29 +2,38 @@
 #include <string.h>
 #include <stdlib.h>
 
+// Whether the current record has produced a character yet; chunks of one
+// record arrive in order on a single thread
+static int g_started = 0;
+
 // Plugin-specific processing function
-static const char* expander_process(const char* str) 
+static const char* expander_process(const char* str, size_t len, unsigned chunk, size_t* out_len) 
 {
     if (!str) return NULL;
+    if (chunk & PLUGIN_CHUNK_BEGIN) g_started = 0;
 
-    size_t len = strlen(str);
-    if (len == 0) return strdup("");
-
-    size_t new_len = len * 2 -1;
+    // A space goes before every character but the record's first, so a chunk's
+    // output does not depend on whether more chunks follow
+    size_t new_len = len * 2 - (len > 0 && !g_started ? 1 : 0);
     char* result = malloc(new_len + 1);
     if (!result) return NULL;
 
+    size_t pos = 0;
     for (size_t i = 0; i < len; i++) 
     {
-        result[i * 2] = str[i]; //even index
-        result[i * 2 + 1] = ' '; //odd index
+        if (g_started) result[pos++] = ' ';
+        result[pos++] = str[i];
+        g_started = 1;
     }
+
     result[new_len] = '\0';
+    *out_len = new_len;
     return result;
 }
 
 // Plugin initialization (new API)
 const char* plugin_init(int queue_size) 
 {
-    return common_plugin_init(expander_process, "expander", queue_size);
+    common_plugin_set_deterministic();
+    return common_plugin_init_stream(expander_process, "expander", queue_size);
 }
\ No newline at end of file
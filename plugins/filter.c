@@ -0,0 +1,353 @@
+#include "plugin_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define FILTER_ENV_MATCH "FILTER_MATCH"
+#define FILTER_ENV_MODE "FILTER_MODE"
+#define FILTER_MAX_SIMD_BYTES 8     // distinct first bytes the SIMD prefilter compares against
+
+typedef struct
+{
+    size_t len;
+    int bol;                    // anchored with ^
+    int eol;                    // anchored with $
+} filter_pattern_t;
+
+// Aho-Corasick automaton compiled into a full DFA over bytes
+typedef struct
+{
+    int* next;                  // states x 256 transitions
+    int* first_out;             // per state: first pattern ending exactly here, -1 if none
+    int* out_next;              // per pattern: next pattern ending at the same state
+    int* dict;                  // per state: nearest suffix state with patterns, -1 if none
+    unsigned char* flags;       // per state: FILTER_HIT_*
+    int states;
+    filter_pattern_t* patterns;
+    int num_patterns;
+    int match_all;              // an empty unanchored pattern matches every line
+    int match_empty;            // "^$" matches empty lines
+    unsigned char first[256];   // bytes that leave the root state
+    unsigned char first_bytes[FILTER_MAX_SIMD_BYTES];
+    int num_first;              // distinct first bytes, counted up to FILTER_MAX_SIMD_BYTES + 1
+} filter_dfa_t;
+
+#define FILTER_HIT_FREE 0x1u        // an unanchored pattern ends here: the line matches
+#define FILTER_HIT_ANCHORED 0x2u    // an anchored pattern ends here: check its position
+
+static filter_dfa_t g_dfa;
+static int g_keep = 1;              // keep matching lines (mode=keep) or drop them (mode=drop)
+static unsigned long g_seen = 0;
+static unsigned long g_passed = 0;
+
+// Split a pattern list on '|' and newlines; "\|", "\^", "\$" and "\\" are literal
+static char** split_patterns(const char* spec, int* count)
+{
+    size_t n = strlen(spec);
+    char** list = calloc(n + 2, sizeof(char*));
+    char* buf = malloc(n + 1);
+    if (!list || !buf)
+    {
+        free(list);
+        free(buf);
+        return NULL;
+    }
+
+    int items = 0;
+    char* out = buf;
+    const char* start = out;
+    for (size_t i = 0; i <= n; i++)
+    {
+        char c = spec[i];
+        if (c == '\\' && i + 1 < n && strchr("|^$\\", spec[i + 1]))
+        {
+            // Keep the backslash before anchors so parse_pattern can tell them apart
+            if (spec[i + 1] == '^' || spec[i + 1] == '$') *out++ = '\\';
+            *out++ = spec[++i];
+            continue;
+        }
+        if (c == '|' || c == '\n' || c == '\0')
+        {
+            *out++ = '\0';
+            if (out - 1 > start || c == '|') list[items++] = (char*)start;
+            start = out;
+            continue;
+        }
+        *out++ = c;
+    }
+    if (items == 0)
+    {
+        free(buf);
+        free(list);
+        *count = 0;
+        return NULL;
+    }
+    *count = items;
+    return list;    // list[0] owns buf
+}
+
+// Strip anchors and escapes in place
+static void parse_pattern(char* text, filter_pattern_t* pattern)
+{
+    size_t len = strlen(text);
+    pattern->bol = len > 0 && text[0] == '^';
+    if (pattern->bol) memmove(text, text + 1, len--);
+    pattern->eol = len > 0 && text[len - 1] == '$' && !(len > 1 && text[len - 2] == '\\');
+    if (pattern->eol) text[--len] = '\0';
+
+    size_t w = 0;
+    for (size_t r = 0; r < len; r++)
+    {
+        if (text[r] == '\\' && r + 1 < len && (text[r + 1] == '^' || text[r + 1] == '$')) r++;
+        text[w++] = text[r];
+    }
+    text[w] = '\0';
+    pattern->len = w;
+}
+
+static void dfa_free(filter_dfa_t* dfa)
+{
+    free(dfa->next);
+    free(dfa->first_out);
+    free(dfa->out_next);
+    free(dfa->dict);
+    free(dfa->flags);
+    free(dfa->patterns);
+    memset(dfa, 0, sizeof(*dfa));
+}
+
+static const char* dfa_build(filter_dfa_t* dfa, char** texts, int count)
+{
+    memset(dfa, 0, sizeof(*dfa));
+    size_t max_states = 1;
+    for (int i = 0; i < count; i++) max_states += strlen(texts[i]);
+    if (max_states > (1u << 22)) return "Patterns too long";
+
+    dfa->next = malloc(max_states * 256 * sizeof(int));
+    dfa->first_out = malloc(max_states * sizeof(int));
+    dfa->dict = malloc(max_states * sizeof(int));
+    dfa->flags = calloc(max_states, 1);
+    dfa->out_next = malloc(count * sizeof(int));
+    dfa->patterns = calloc(count, sizeof(filter_pattern_t));
+    int* fail = malloc(max_states * sizeof(int));
+    int* queue = malloc(max_states * sizeof(int));
+    if (!dfa->next || !dfa->first_out || !dfa->dict || !dfa->flags || !dfa->out_next || !dfa->patterns ||
+        !fail || !queue)
+    {
+        free(fail);
+        free(queue);
+        dfa_free(dfa);
+        return "Memory allocation failed";
+    }
+    dfa->num_patterns = count;
+
+    // Trie
+    memset(dfa->next, -1, 256 * sizeof(int));
+    dfa->first_out[0] = -1;
+    dfa->states = 1;
+    for (int p = 0; p < count; p++)
+    {
+        filter_pattern_t* pat = &dfa->patterns[p];
+        parse_pattern(texts[p], pat);
+        dfa->out_next[p] = -1;
+        if (pat->len == 0)
+        {
+            if (pat->bol && pat->eol) dfa->match_empty = 1;
+            else dfa->match_all = 1;
+            continue;
+        }
+        int s = 0;
+        for (size_t i = 0; i < pat->len; i++)
+        {
+            unsigned char c = (unsigned char)texts[p][i];
+            if (dfa->next[s * 256 + c] < 0)
+            {
+                int t = dfa->states++;
+                memset(dfa->next + (size_t)t * 256, -1, 256 * sizeof(int));
+                dfa->first_out[t] = -1;
+                dfa->next[s * 256 + c] = t;
+            }
+            s = dfa->next[s * 256 + c];
+        }
+        dfa->out_next[p] = dfa->first_out[s];
+        dfa->first_out[s] = p;
+        dfa->flags[s] |= (pat->bol || pat->eol) ? FILTER_HIT_ANCHORED : FILTER_HIT_FREE;
+    }
+
+    // Failure links in BFS order, folded into a complete transition table
+    int head = 0, tail = 0;
+    fail[0] = 0;
+    dfa->dict[0] = -1;
+    for (int c = 0; c < 256; c++)
+    {
+        int t = dfa->next[c];
+        if (t < 0)
+        {
+            dfa->next[c] = 0;
+            continue;
+        }
+        fail[t] = 0;
+        dfa->dict[t] = -1;
+        queue[tail++] = t;
+    }
+    while (head < tail)
+    {
+        int s = queue[head++];
+        for (int c = 0; c < 256; c++)
+        {
+            int t = dfa->next[s * 256 + c];
+            int via_fail = dfa->next[fail[s] * 256 + c];
+            if (t < 0)
+            {
+                dfa->next[s * 256 + c] = via_fail;
+                continue;
+            }
+            fail[t] = via_fail;
+            dfa->dict[t] = dfa->first_out[via_fail] >= 0 ? via_fail : dfa->dict[via_fail];
+            // Whatever ends at a suffix state also ends here
+            dfa->flags[t] |= dfa->flags[via_fail];
+            queue[tail++] = t;
+        }
+    }
+    free(fail);
+    free(queue);
+
+    for (int c = 0; c < 256; c++)
+    {
+        if (dfa->next[c] == 0) continue;
+        dfa->first[c] = 1;
+        if (dfa->num_first < FILTER_MAX_SIMD_BYTES) dfa->first_bytes[dfa->num_first] = (unsigned char)c;
+        if (dfa->num_first <= FILTER_MAX_SIMD_BYTES) dfa->num_first++;
+    }
+    return NULL;
+}
+
+// Index of the first byte at or after i that can start a pattern, or len
+static size_t skip_to_candidate(const filter_dfa_t* dfa, const unsigned char* data, size_t i, size_t len)
+{
+    if (dfa->num_first == 0) return len;
+    if (dfa->num_first == 1)
+    {
+        const void* hit = memchr(data + i, dfa->first_bytes[0], len - i);
+        return hit ? (size_t)((const unsigned char*)hit - data) : len;
+    }
+#ifdef __SSE2__
+    if (dfa->num_first <= FILTER_MAX_SIMD_BYTES)
+    {
+        // Compare 16 bytes against every first byte at once; skip blocks with no candidate
+        __m128i needles[FILTER_MAX_SIMD_BYTES];
+        for (int k = 0; k < dfa->num_first; k++) needles[k] = _mm_set1_epi8((char)dfa->first_bytes[k]);
+        for (; i + 16 <= len; i += 16)
+        {
+            __m128i block = _mm_loadu_si128((const __m128i*)(data + i));
+            __m128i any = _mm_cmpeq_epi8(block, needles[0]);
+            for (int k = 1; k < dfa->num_first; k++) any = _mm_or_si128(any, _mm_cmpeq_epi8(block, needles[k]));
+            int mask = _mm_movemask_epi8(any);
+            if (mask) return i + (size_t)__builtin_ctz((unsigned)mask);
+        }
+    }
+#endif
+    while (i < len && !dfa->first[data[i]]) i++;
+    return i;
+}
+
+// Does any pattern ending at state s (position end) satisfy its anchors?
+static int anchored_hit(const filter_dfa_t* dfa, int s, size_t end, size_t len)
+{
+    for (; s >= 0; s = dfa->dict[s])
+    {
+        for (int p = dfa->first_out[s]; p >= 0; p = dfa->out_next[p])
+        {
+            const filter_pattern_t* pat = &dfa->patterns[p];
+            if ((!pat->bol || end + 1 == pat->len) && (!pat->eol || end + 1 == len)) return 1;
+        }
+    }
+    return 0;
+}
+
+static int dfa_match(const filter_dfa_t* dfa, const char* text, size_t len)
+{
+    if (dfa->match_all || (dfa->match_empty && len == 0)) return 1;
+
+    const unsigned char* data = (const unsigned char*)text;
+    int s = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        // In the root state nothing is partially matched, so jump to the next candidate byte
+        if (s == 0)
+        {
+            i = skip_to_candidate(dfa, data, i, len);
+            if (i == len) break;
+        }
+        s = dfa->next[s * 256 + data[i]];
+        unsigned char f = dfa->flags[s];
+        if (f & FILTER_HIT_FREE) return 1;
+        if ((f & FILTER_HIT_ANCHORED) && anchored_hit(dfa, s, i, len)) return 1;
+    }
+    return 0;
+}
+
+// Plugin-specific processing function: pass the record through or drop it
+static const char* filter_process(const char* str, size_t len, size_t* out_len)
+{
+    if (!str) return NULL;
+    g_seen++;
+    if (dfa_match(&g_dfa, str, len) != g_keep) return NULL;
+    g_passed++;
+    *out_len = len;
+    return str;
+}
+
+static void filter_batch(plugin_record_t* records, size_t count)
+{
+    for (size_t r = 0; r < count; r++)
+    {
+        int keep = dfa_match(&g_dfa, records[r].data, records[r].len) == g_keep;
+        records[r].out = keep ? (char*)records[r].data : NULL;
+    }
+    g_seen += count;
+    for (size_t r = 0; r < count; r++) g_passed += records[r].out != NULL;
+}
+
+static void filter_flush(int final)
+{
+    if (!final) return;
+    char msg[96];
+    snprintf(msg, sizeof(msg), "Passed %lu of %lu lines", g_passed, g_seen);
+    common_plugin_log_info(msg);
+    dfa_free(&g_dfa);
+}
+
+// Plugin initialization (new API)
+const char* plugin_init(int queue_size)
+{
+    const char* spec = common_plugin_option("match");
+    if (!spec) spec = getenv(FILTER_ENV_MATCH);
+    if (!spec) return "No patterns: set match=PATTERNS or " FILTER_ENV_MATCH;
+
+    const char* mode = common_plugin_option("mode");
+    if (!mode) mode = getenv(FILTER_ENV_MODE);
+    if (!mode || strcmp(mode, "keep") == 0) g_keep = 1;
+    else if (strcmp(mode, "drop") == 0) g_keep = 0;
+    else return "Expected mode=keep or mode=drop";
+
+    int count = 0;
+    char** texts = split_patterns(spec, &count);
+    if (!texts) return "No patterns: set match=PATTERNS or " FILTER_ENV_MATCH;
+    const char* err = dfa_build(&g_dfa, texts, count);
+    free(texts[0]);
+    free(texts);
+    if (err) return err;
+
+    g_seen = 0;
+    g_passed = 0;
+    common_plugin_set_deterministic();
+    common_plugin_set_batch(filter_batch);
+    common_plugin_set_flush(filter_flush);
+    err = common_plugin_init_len(filter_process, "filter", queue_size);
+    if (err) dfa_free(&g_dfa);
+    return err;
+}
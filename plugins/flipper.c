@@ -2,15 +2,11 @@
 #include <string.h>
 #include <stdlib.h>
 
-
 // Plugin-specific processing function
-static const char* flipper_process(const char* str) 
+static const char* flipper_process(const char* str, size_t len, size_t* out_len) 
 {
     if (!str) return NULL;
 
-    size_t len = strlen(str);
-    if (len == 0) return strdup("");
-
     char* result = malloc(len + 1);
     if (!result) return NULL;
 
@@ -18,12 +14,29 @@ static const char* flipper_process(const char* str)
     {
         result[i] = str[len - 1 - i];
     }
+
     result[len] = '\0';
+    *out_len = len;
     return result;
 }
 
+// Batch path: reverse each record into the scratch space provided
+static void flipper_batch(plugin_record_t* records, size_t count)
+{
+    for (size_t r = 0; r < count; r++)
+    {
+        const char* in = records[r].data;
+        char* out = records[r].out;
+        size_t len = records[r].len;
+        for (size_t i = 0; i < len; i++) out[i] = in[len - 1 - i];
+        records[r].out_len = len;
+    }
+}
+
 // Plugin initialization (new API)
 const char* plugin_init(int queue_size) 
 {
-    return common_plugin_init(flipper_process, "flipper", queue_size);
+    common_plugin_set_deterministic();
+    common_plugin_set_batch(flipper_batch);
+    return common_plugin_init_len(flipper_process, "flipper", queue_size);
 }
\ No newline at end of file
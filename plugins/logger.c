@@ -1,23 +1,89 @@
 #include "plugin_common.h"
+#include "out_writer.h"
+#include "varint.h"
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
+
+#define LOGGER_PREFIX "[logger] "
+
+// Output is batched and written when the buffer fills or the stage goes idle
+static out_writer_t g_out;
+// framing=varint: emit bare length-prefixed records instead of text lines
+static int g_framed = 0;
 
 // Plugin-specific processing function
-static const char* logger_process(const char* str) 
+static const char* logger_process(const char* str, size_t len, size_t* out_len) 
 {
     if (!str) return NULL;
 
     // Log the string
-    fputs("[logger] ", stdout);
-    fputs(str, stdout);
-    putchar('\n');
-    fflush(stdout);
-    // Return the original string unchanged
-    return strdup(str);
+    if (g_framed)
+    {
+        unsigned char header[VARINT_MAX_BYTES];
+        out_writer_append(&g_out, (const char*)header, varint_encode(len, header));
+        out_writer_append(&g_out, str, len);
+    }
+    else
+    {
+        out_writer_append(&g_out, LOGGER_PREFIX, sizeof(LOGGER_PREFIX) - 1);
+        out_writer_append(&g_out, str, len);
+        out_writer_append(&g_out, "\n", 1);
+    }
+
+    // Pass the original record through unchanged
+    *out_len = len;
+    return str;
+}
+
+// Text output can be written as chunks arrive; a framed record needs its full
+// length up front, so framed mode uses logger_process on reassembled records
+static const char* logger_process_chunk(const char* str, size_t len, unsigned chunk, size_t* out_len) 
+{
+    if (!str) return NULL;
+
+    if (chunk & PLUGIN_CHUNK_BEGIN) out_writer_append(&g_out, LOGGER_PREFIX, sizeof(LOGGER_PREFIX) - 1);
+    out_writer_append(&g_out, str, len);
+    if (chunk & PLUGIN_CHUNK_END) out_writer_append(&g_out, "\n", 1);
+
+    // Pass the original chunk through unchanged
+    *out_len = len;
+    return str;
+}
+
+static void logger_flush(int final)
+{
+    if (!final)
+    {
+        out_writer_flush(&g_out, 0);
+        return;
+    }
+    out_writer_destroy(&g_out);
+    if (g_out.error)
+    {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Output write failed: %s", strerror(g_out.error));
+        common_plugin_log_error(msg);
+    }
 }
 
 // Plugin initialization (new API)
 const char* plugin_init(int queue_size) 
 {
-    return common_plugin_init(logger_process, "logger", queue_size);
-}
\ No newline at end of file
+    const char* framing = common_plugin_option("framing");
+    g_framed = framing && strcmp(framing, "varint") == 0;
+
+    const char* io = common_plugin_option("io");
+    int use_uring = io && strcmp(io, "uring") == 0;
+    if (out_writer_init(&g_out, STDOUT_FILENO, use_uring) != 0) return "Memory allocation failed";
+    common_plugin_set_flush(logger_flush);
+    const char* err = g_framed ? common_plugin_init_len(logger_process, "logger", queue_size)
+                               : common_plugin_init_stream(logger_process_chunk, "logger", queue_size);
+    if (err)
+    {
+        common_plugin_set_flush(NULL);
+        out_writer_destroy(&g_out);
+    }
+    else if (use_uring && !g_out.use_uring) common_plugin_log_info("io_uring unavailable, using write()");
+    return err;
+}
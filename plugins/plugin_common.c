@@ -3,32 +3,527 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <locale.h>
 
 #define SENTINEL_END "<END>"
+#define ADAPTIVE_DEFAULT_GROWTH 64      // default max_capacity = queue_size * this
+#define ADAPTIVE_CAPACITY_LIMIT (1 << 20)
+#define BATCH_SCRATCH_KEEP (1 << 20)    // larger batch scratch is released after use
+#define CACHE_MAX_RECORD 4096           // longer records bypass the result cache
 
 static plugin_context_t* g_ctx = NULL;
 
+// Per-stage options recorded by plugin_configure() ahead of plugin_init()
+typedef struct {
+    char* key;
+    char* value;
+} plugin_option_t;
+
+static plugin_option_t* g_options = NULL;
+static int g_num_options = 0;
+
+static mem_budget_t* g_budget = NULL;
+
+// Set by plugin_set_wakeup(): an external scheduler drives plugin_run() instead of our own thread
+static void (*g_wake)(void*) = NULL;
+static void* g_wake_arg = NULL;
+
+// Set by common_plugin_set_flush(): run when the stage runs out of queued work
+static void (*g_flush)(int final) = NULL;
+
+// Set by common_plugin_set_batch(): whole records are processed in batches
+static plugin_process_batch_t g_batch = NULL;
+
+// Set by common_plugin_set_deterministic(): the cache option is allowed
+static int g_deterministic = 0;
+
+// Set by plugin_set_counters(): the consumer thread measures itself
+static perf_counters_t* g_counters = NULL;
+static int g_counters_stage = -1;
+
+// Stage threads hand log lines to a drain thread instead of writing stderr themselves.
+// Set by plugin_set_log(): one ring and drain thread owned by the host for every stage.
+static log_ring_t* g_shared_log = NULL;
+
+// Without a host ring the stage starts its own, on the first line it logs
+enum { OWN_LOG_IDLE = 0, OWN_LOG_STARTING, OWN_LOG_RUNNING, OWN_LOG_FAILED };
+static log_ring_t g_own_log;
+static atomic_int g_own_log_state = OWN_LOG_IDLE;
+
 static inline const char* safe_name(plugin_context_t* ctx){
     return (ctx && ctx->name) ? ctx->name : "unknown";
 }
 
+// NULL while no ring can take the line yet; the caller writes stderr directly
+static log_ring_t* stage_log(plugin_context_t* context){
+    if (g_shared_log) return g_shared_log;
+    int state = atomic_load(&g_own_log_state);
+    if (state == OWN_LOG_RUNNING) return &g_own_log;
+    if (state != OWN_LOG_IDLE || !atomic_compare_exchange_strong(&g_own_log_state, &state, OWN_LOG_STARTING)) return NULL;
+    if (log_ring_start(&g_own_log, safe_name(context)) != NULL){
+        atomic_store(&g_own_log_state, OWN_LOG_FAILED);
+        return NULL;
+    }
+    atomic_store(&g_own_log_state, OWN_LOG_RUNNING);
+    return &g_own_log;
+}
+
 void log_error(plugin_context_t* context, const char* message){
+    if (log_ring_write(stage_log(context), "ERROR", safe_name(context), message ? message : "(null)") >= 0) return;
     fprintf(stderr, "[ERROR][%s] - %s\n", safe_name(context), message ? message : "(null)");
 }
 
 void log_info(plugin_context_t* context, const char* message){
+    if (log_ring_write(stage_log(context), "INFO", safe_name(context), message ? message : "(null)") >= 0) return;
     fprintf(stderr, "[INFO][%s] - %s\n", safe_name(context), message ? message : "(null)");
 }
 
+void common_plugin_log_error(const char* message){
+    log_error(g_ctx, message);
+}
+
+void common_plugin_log_info(const char* message){
+    log_info(g_ctx, message);
+}
+
+static int parse_positive_int(const char* value, int* out){
+    char* end;
+    errno = 0;
+    long v = strtol(value, &end, 10);
+    if (errno == ERANGE || end == value || *end != '\0' || v < 1 || v > INT_MAX) return -1;
+    *out = (int)v;
+    return 0;
+}
+
+const char* plugin_configure(const char* key, const char* value){
+    if (!key || !value) return "Invalid parameters";
+    if (g_ctx) return "Options must be set before plugin_init";
+
+    if (strcmp(key, "policy") == 0){
+        cp_policy_t policy;
+        if (consumer_producer_parse_policy(value, &policy) != 0) return "Unknown policy";
+    } else if (strcmp(key, "handoff") == 0){
+        if (strcmp(value, "queue") != 0 && strcmp(value, "inline") != 0) return "Expected queue or inline";
+    } else if (strcmp(key, "framing") == 0){
+        if (strcmp(value, "lines") != 0 && strcmp(value, "varint") != 0) return "Expected lines or varint";
+    } else if (strcmp(key, "io") == 0){
+        if (strcmp(value, "sync") != 0 && strcmp(value, "uring") != 0) return "Expected sync or uring";
+    } else if (strcmp(key, "adaptive") == 0){
+        if (strcmp(value, "on") != 0 && strcmp(value, "off") != 0) return "Expected on or off";
+    } else if (strcmp(key, "min_capacity") == 0 || strcmp(key, "max_capacity") == 0 || strcmp(key, "cache") == 0){
+        int n;
+        if (parse_positive_int(value, &n) != 0) return "Expected a positive integer";
+    }
+
+    plugin_option_t* grown = realloc(g_options, (g_num_options + 1) * sizeof(*grown));
+    if (!grown) return "Memory allocation failed";
+    g_options = grown;
+
+    plugin_option_t* opt = &g_options[g_num_options];
+    opt->key = strdup(key);
+    opt->value = strdup(value);
+    if (!opt->key || !opt->value){
+        free(opt->key);
+        free(opt->value);
+        return "Memory allocation failed";
+    }
+    g_num_options++;
+    return NULL;
+}
+
+const char* common_plugin_option(const char* key){
+    if (!key) return NULL;
+    // Last assignment wins
+    for (int i = g_num_options - 1; i >= 0; i--){
+        if (strcmp(g_options[i].key, key) == 0) return g_options[i].value;
+    }
+    return NULL;
+}
+
+static void free_options(void){
+    for (int i = 0; i < g_num_options; i++){
+        free(g_options[i].key);
+        free(g_options[i].value);
+    }
+    free(g_options);
+    g_options = NULL;
+    g_num_options = 0;
+}
+
+void plugin_set_budget(mem_budget_t* budget){
+    // Only takes effect at plugin_init; swapping budgets under live traffic would skew accounting
+    g_budget = budget;
+}
+
+void plugin_set_trace(trace_t* trace, int stage){
+    // Recording starts right away; the consumer thread names itself once created
+    trace_attach(trace, stage);
+}
+
+void plugin_set_log(log_ring_t* log){
+    g_shared_log = log;
+}
+
+void plugin_set_counters(perf_counters_t* counters, int stage){
+    g_counters = counters;
+    g_counters_stage = stage;
+}
+
 const char* plugin_get_name(void) {
     return (g_ctx && g_ctx->name) ? g_ctx->name : "unknown";
 }
 
+// Threads created by another namespace's libc (pool workers, the analyzer's main thread)
+// never ran this libc's per-thread setup, leaving e.g. the ctype tables behind toupper()
+// unset. uselocale() fills them in; do it once per thread before running plugin code.
+static __thread int tls_thread_adopted = 0;
+
+static void adopt_foreign_thread(void){
+    if (tls_thread_adopted) return;
+    uselocale(LC_GLOBAL_LOCALE);
+    tls_thread_adopted = 1;
+}
+
+// Hand a record to the next stage (if any). Prefers the length-aware entry point;
+// the string entry point needs a terminated copy for borrowed slices.
+static void deliver_slice(plugin_context_t* context, const char* data, size_t len, unsigned flags){
+    const char* err = NULL;
+    if (context->next_place_slice){
+        err = context->next_place_slice(data, len, flags);
+    } else if (context->next_place_work){
+        if (flags & CP_ITEM_BORROWED){
+            char* copy = malloc(len + 1);
+            if (!copy){
+                log_error(context, "Memory allocation failed");
+                return;
+            }
+            memcpy(copy, data, len);
+            copy[len] = '\0';
+            err = context->next_place_work(copy);
+            free(copy);
+        } else {
+            err = context->next_place_work(data);
+        }
+    }
+    if (err) log_error(context, err);
+}
+
+static int has_pending(const plugin_context_t* context){
+    return context->pending_head < context->num_pending;
+}
+
+// External mode: keep a copy of the record until plugin_run() has downstream space for it
+static void stash_slice(plugin_context_t* context, const char* data, size_t len, unsigned flags){
+    if (context->num_pending == context->cap_pending){
+        int cap = context->cap_pending ? context->cap_pending * 2 : 16;
+        plugin_pending_t* grown = realloc(context->pending, cap * sizeof(*grown));
+        if (!grown){
+            log_error(context, "Memory allocation failed");
+            return;
+        }
+        context->pending = grown;
+        context->cap_pending = cap;
+    }
+    char* copy = malloc(len + 1);
+    if (!copy){
+        log_error(context, "Memory allocation failed");
+        return;
+    }
+    memcpy(copy, data, len);
+    copy[len] = '\0';
+    plugin_pending_t* p = &context->pending[context->num_pending++];
+    p->data = copy;
+    p->len = len;
+    p->flags = flags & CP_ITEM_CHUNK_MASK;
+}
+
+// Forward up to max_records held-back records in order; returns how many were sent
+static int drain_pending(plugin_context_t* context, int max_records){
+    int sent = 0;
+    while (has_pending(context) && sent < max_records){
+        plugin_pending_t* p = &context->pending[context->pending_head++];
+        deliver_slice(context, p->data, p->len, p->flags);
+        free(p->data);
+        sent++;
+    }
+    if (!has_pending(context)) context->pending_head = context->num_pending = 0;
+    return sent;
+}
+
+// Once something is held back, later records queue behind it to keep their order
+static void forward_slice(plugin_context_t* context, const char* data, size_t len, unsigned flags){
+    if (context->external && has_pending(context)) stash_slice(context, data, len, flags);
+    else deliver_slice(context, data, len, flags);
+}
+
+static void process_record(plugin_context_t* context, const char* data, size_t len, unsigned flags);
+
+// Forward a remembered result for a whole record
+static void forward_cached(plugin_context_t* context, const result_cache_entry_t* hit,
+                           const char* data, size_t len, unsigned flags){
+    if (hit->kind == RESULT_CACHE_PASS) forward_slice(context, data, len, flags & CP_ITEM_BORROWED);
+    else if (hit->kind == RESULT_CACHE_OUTPUT) forward_slice(context, hit->out, hit->out_len, 0);
+}
+
+// Remember what the plugin did with a whole record
+static void remember_result(plugin_context_t* context, const char* data, size_t len,
+                            const char* processed, size_t out_len){
+    if (!context->cache) return;
+    result_cache_kind_t kind = processed == data ? RESULT_CACHE_PASS : processed ? RESULT_CACHE_OUTPUT : RESULT_CACHE_DROP;
+    result_cache_store(context->cache, data, len, kind, processed, out_len);
+}
+
+// Run whole records through the batch function and forward the results in order.
+// Outputs live in one scratch buffer instead of a heap allocation per record.
+static void process_batch(plugin_context_t* context, const cp_item_t* items, int count){
+    // Only misses go to the plugin; record[i] is the batch slot of item i, -1 for a hit
+    const result_cache_entry_t* hits[PLUGIN_BATCH_MAX];
+    int record[PLUGIN_BATCH_MAX];
+    int misses = 0;
+    size_t total = 0;
+    for (int i = 0; i < count; i++){
+        hits[i] = context->cache ? result_cache_lookup(context->cache, items[i].data, items[i].len) : NULL;
+        record[i] = hits[i] ? -1 : misses++;
+        if (!hits[i]) total += items[i].len + 1;
+    }
+    if (total > context->batch_scratch_cap){
+        free(context->batch_scratch);
+        context->batch_scratch = malloc(total);
+        context->batch_scratch_cap = context->batch_scratch ? total : 0;
+        if (!context->batch_scratch){
+            log_error(context, "Memory allocation failed");
+            return;
+        }
+    }
+
+    char* scratch = context->batch_scratch;
+    for (int i = 0; i < count; i++){
+        if (record[i] < 0) continue;
+        plugin_record_t* rec = &context->batch[record[i]];
+        rec->data = items[i].data;
+        rec->len = items[i].len;
+        rec->out = scratch;
+        rec->out_len = 0;
+        scratch += items[i].len + 1;
+    }
+
+    if (misses > 0){
+        uint64_t traced = trace_begin();
+        context->process_batch(context->batch, (size_t)misses);
+        trace_end(TRACE_PROCESS, traced);
+    }
+
+    for (int i = 0; i < count; i++){
+        if (record[i] < 0){
+            forward_cached(context, hits[i], items[i].data, items[i].len, items[i].flags);
+            continue;
+        }
+        plugin_record_t* rec = &context->batch[record[i]];
+        if (rec->out == rec->data){
+            forward_slice(context, rec->data, rec->len, items[i].flags & CP_ITEM_BORROWED);
+        } else if (rec->out){
+            if (rec->out_len > rec->len) rec->out_len = rec->len;
+            rec->out[rec->out_len] = '\0';
+            forward_slice(context, rec->out, rec->out_len, 0);
+        }
+    }
+    // Stores may evict entries, so only after every hit has been forwarded
+    for (int i = 0; context->cache && i < misses; i++){
+        plugin_record_t* rec = &context->batch[i];
+        remember_result(context, rec->data, rec->len, rec->out, rec->out_len);
+    }
+
+    if (context->batch_scratch_cap > BATCH_SCRATCH_KEEP){
+        free(context->batch_scratch);
+        context->batch_scratch = NULL;
+        context->batch_scratch_cap = 0;
+    }
+}
+
+// Streaming stage: every chunk is processed and forwarded as the same chunk
+static void process_stream_chunk(plugin_context_t* context, const char* data, size_t len, unsigned flags){
+    unsigned chunk_flags = flags & CP_ITEM_CHUNK_MASK;
+    unsigned chunk = PLUGIN_CHUNK_BEGIN | PLUGIN_CHUNK_END;
+    if (chunk_flags){
+        chunk = ((chunk_flags & CP_ITEM_CHUNK_BEGIN) ? PLUGIN_CHUNK_BEGIN : 0) |
+                ((chunk_flags & CP_ITEM_CHUNK_END) ? PLUGIN_CHUNK_END : 0);
+    }
+
+    size_t out_len = 0;
+    uint64_t traced = trace_begin();
+    const char* processed = context->process_stream(data, len, chunk, &out_len);
+    trace_end(TRACE_PROCESS, traced);
+    if (!chunk_flags) remember_result(context, data, len, processed, out_len);
+    if (processed == data){
+        forward_slice(context, data, len, flags & (CP_ITEM_BORROWED | CP_ITEM_CHUNK_MASK));
+    } else if (processed){
+        forward_slice(context, processed, out_len, chunk_flags);
+        free((void*)processed); // always free processed result after forwarding
+    } else if (chunk_flags){
+        // Downstream still needs this chunk's position to see the record through
+        forward_slice(context, "", 0, chunk_flags);
+    }
+}
+
+// Non-streaming stage: collect chunks and process the record once it is whole.
+// A chunk sequence broken by a drop policy is discarded.
+static void assemble_chunk(plugin_context_t* context, const char* data, size_t len, unsigned flags){
+    if (flags & CP_ITEM_CHUNK_BEGIN){
+        context->assembling = 1;
+        context->assembly_len = 0;
+    } else if (!context->assembling){
+        return;
+    }
+
+    if (context->assembly_len + len + 1 > context->assembly_cap){
+        size_t cap = context->assembly_cap ? context->assembly_cap : 4096;
+        while (context->assembly_len + len + 1 > cap) cap *= 2;
+        char* grown = realloc(context->assembly, cap);
+        if (!grown){
+            log_error(context, "Memory allocation failed");
+            context->assembling = 0;
+            return;
+        }
+        context->assembly = grown;
+        context->assembly_cap = cap;
+    }
+    memcpy(context->assembly + context->assembly_len, data, len);
+    context->assembly_len += len;
+    if (!(flags & CP_ITEM_CHUNK_END)) return;
+
+    context->assembly[context->assembly_len] = '\0';
+    context->assembling = 0;
+    context->reassembled++;
+    process_record(context, context->assembly, context->assembly_len, 0);
+
+    // Do not hold on to a record-sized buffer between large records
+    free(context->assembly);
+    context->assembly = NULL;
+    context->assembly_cap = 0;
+}
+
+// Run one record through the plugin and forward the result. The record itself
+// stays owned by the caller. A length-aware plugin returning its input pointer
+// passes the record through untouched, so borrowed slices stay zero-copy.
+static void process_record(plugin_context_t* context, const char* data, size_t len, unsigned flags){
+    if (context->cache && !(flags & CP_ITEM_CHUNK_MASK) && !context->process_batch){
+        const result_cache_entry_t* hit = result_cache_lookup(context->cache, data, len);
+        if (hit){
+            forward_cached(context, hit, data, len, flags);
+            return;
+        }
+    }
+    if (context->process_batch && !(flags & CP_ITEM_CHUNK_MASK)){
+        cp_item_t one = { (char*)data, len, flags };
+        process_batch(context, &one, 1);
+        return;
+    }
+    if (context->process_stream){
+        process_stream_chunk(context, data, len, flags);
+        return;
+    }
+    if (flags & CP_ITEM_CHUNK_MASK){
+        assemble_chunk(context, data, len, flags);
+        return;
+    }
+
+    if (context->process_len){
+        size_t out_len = 0;
+        uint64_t traced = trace_begin();
+        const char* processed = context->process_len(data, len, &out_len);
+        trace_end(TRACE_PROCESS, traced);
+        remember_result(context, data, len, processed, out_len);
+        if (processed == data){
+            forward_slice(context, data, len, flags & CP_ITEM_BORROWED);
+        } else if (processed){
+            forward_slice(context, processed, out_len, 0);
+            free((void*)processed); // always free processed result after forwarding
+        }
+        return;
+    }
+
+    // String plugins need a terminator, which borrowed slices do not carry
+    char* copy = NULL;
+    if (flags & CP_ITEM_BORROWED){
+        copy = malloc(len + 1);
+        if (!copy){
+            log_error(context, "Memory allocation failed");
+            return;
+        }
+        memcpy(copy, data, len);
+        copy[len] = '\0';
+    }
+    uint64_t traced = trace_begin();
+    const char* processed = context->process_func(copy ? copy : data);
+    trace_end(TRACE_PROCESS, traced);
+    free(copy);
+    remember_result(context, data, len, processed, processed ? strlen(processed) : 0);
+    if (processed){
+        forward_slice(context, processed, strlen(processed), 0);
+        free((void*)processed); // always free processed result after forwarding
+    }
+}
+
+// Process dequeued items in order and release them. Runs of whole records go to the
+// batch function together; a chunk in between is handled on its own.
+static void process_items(plugin_context_t* context, cp_item_t* items, int count){
+    if (context->process_batch){
+        int start = 0;
+        for (int i = 0; i < count; i++){
+            if (!(items[i].flags & CP_ITEM_CHUNK_MASK)) continue;
+            if (i > start) process_batch(context, items + start, i - start);
+            process_record(context, items[i].data, items[i].len, items[i].flags);
+            start = i + 1;
+        }
+        if (count > start) process_batch(context, items + start, count - start);
+    } else {
+        for (int i = 0; i < count; i++) process_record(context, items[i].data, items[i].len, items[i].flags);
+    }
+    for (int i = 0; i < count; i++){
+        if (!(items[i].flags & CP_ITEM_BORROWED)) free(items[i].data); // queue item always freed here
+    }
+}
+
+void common_plugin_set_flush(void (*flush)(int final)){
+    g_flush = flush;
+}
+
+void common_plugin_set_batch(plugin_process_batch_t process_batch){
+    g_batch = process_batch;
+}
+
+void common_plugin_set_deterministic(void){
+    g_deterministic = 1;
+}
+
+void common_plugin_emit(const char* data, size_t len){
+    if (!g_ctx || !g_ctx->initialized || !data) return;
+    // plugin_run() only reserves downstream space for one output per input
+    if (g_ctx->external) stash_slice(g_ctx, data, len, 0);
+    else forward_slice(g_ctx, data, len, 0);
+}
+
+static void forward_sentinel(plugin_context_t* context){
+    if (context->next_place_work){
+        const char* err = context->next_place_work(SENTINEL_END);
+        if (err) log_error(context, err);
+    }
+}
+
+// Queue is finished and drained: propagate the sentinel to the next stage
+static void finish_stage(plugin_context_t* context){
+    if (context->flush) context->flush(1);
+    forward_sentinel(context);
+}
+
 /* Consumer thread: drains queue, processes items, forwards to next stage (if any).
  * Contract:
- * - Items returned by consumer_producer_take are heap pointers we must free.
- * - Processed strings returned by process_func are heap pointers that we own and must free
- *   if there is no next stage.
+ * - Items returned by consumer_producer_get_item are heap copies we must free, unless
+ *   they are borrowed slices (CP_ITEM_BORROWED) that live in producer memory.
+ * - Processed results returned by process_func/process_len are heap pointers that we own
+ *   and free after forwarding (the next stage copies what it keeps).
  * - Sentinel handling:
  *   plugin_place_work() does not enqueue SENTINEL_END; it only signals 'finished' on the queue.
  *   After we drain the queue here, we propagate SENTINEL_END downstream (if any).
@@ -36,46 +531,109 @@ const char* plugin_get_name(void) {
 void* plugin_consumer_thread(void* arg){
     plugin_context_t* context = (plugin_context_t*)arg;
     //log_info(context, "Consumer thread started");
+    trace_thread_label(context->name);
+    perf_thread_t counted;
+    unsigned long lines = 0;
+    if (g_counters) perf_thread_start(g_counters, &counted);
 
+    // Batch stages take whatever has piled up, up to PLUGIN_BATCH_MAX records per lock
+    cp_item_t items[PLUGIN_BATCH_MAX];
+    int max_items = context->process_batch ? PLUGIN_BATCH_MAX : 1;
     for(;;){
-        char* item = consumer_producer_get(context->queue);
-        if (!item) {
-            // Queue is finished and empty.
-            break;
-        }
-
-        // Process normally
-        const char* processed = context->process_func(item);
-        free(item); // queue item always freed here
-
-        if (processed){
-            if (context->next_place_work){
-                const char* err = context->next_place_work(processed);
-                if (err) log_error(context, err);
-                free((void*)processed); // always free processed result after forwarding
-            } else {
-                // No next stage: we must free the processed result.
-                free((void*)processed);
+        int count;
+        if (context->flush){
+            // Flush batched output before going to sleep on an empty queue
+            count = consumer_producer_try_get_items(context->queue, items, max_items);
+            if (count == 0){
+                context->flush(0);
+                count = consumer_producer_get_items(context->queue, items, max_items);
             }
+            if (count <= 0) break; // Queue is finished and empty.
+        } else {
+            count = consumer_producer_get_items(context->queue, items, max_items);
+            if (count == 0) break; // Queue is finished and empty.
+        }
+        // Whole records and last chunks, so chunked input is not counted once per chunk
+        for (int i = 0; i < count; i++){
+            if (!(items[i].flags & CP_ITEM_CHUNK_MASK) || (items[i].flags & CP_ITEM_CHUNK_END)) lines++;
         }
+        process_items(context, items, count);
     }
 
     // Propagate sentinel to the next stage after draining
-    if (context->next_place_work){
-        const char* err = context->next_place_work(SENTINEL_END);
-        if (err) log_error(context, err);
-    }
+    finish_stage(context);
+    if (g_counters) perf_thread_stop(g_counters, g_counters_stage, &counted, lines);
 
     //log_info(context, "Consumer thread exiting");
     return NULL;
 }
 
-const char* common_plugin_init(const char* (*process_function)(const char*),
+static void* noop_thread(void* arg){
+    return arg;
+}
+
+int plugin_run(int max_items){
+    if (!g_ctx || !g_ctx->external) return -1;
+    if (g_ctx->done) return -1;
+    adopt_foreign_thread();
+
+    // max_items is the downstream space the scheduler granted; each forwarded record takes
+    // one slot. Inputs are counted as one output each, emitted extras as they are drained.
+    cp_item_t items[PLUGIN_BATCH_MAX];
+    int per_call = g_ctx->process_batch ? PLUGIN_BATCH_MAX : 1;
+    int used = drain_pending(g_ctx, max_items);
+    int processed = 0;
+    while (!has_pending(g_ctx) && used < max_items){
+        int want = max_items - used < per_call ? max_items - used : per_call;
+        int rc = consumer_producer_try_get_items(g_ctx->queue, items, want);
+        if (rc == 0){
+            if (g_ctx->flush) g_ctx->flush(0);
+            used += drain_pending(g_ctx, max_items - used);
+            // Spilled records that failed to read back get no wakeup of their own
+            if (consumer_producer_backlog(g_ctx->queue) > 0) return max_items;
+            break;
+        }
+        if (rc < 0){
+            // The final flush may emit more than fits; the sentinel waits until it is all sent
+            if (!g_ctx->final_flushed){
+                g_ctx->final_flushed = 1;
+                if (g_ctx->flush) g_ctx->flush(1);
+            }
+            drain_pending(g_ctx, max_items - used);
+            if (has_pending(g_ctx)) return max_items;
+            forward_sentinel(g_ctx);
+            g_ctx->done = 1;
+            monitor_signal(&g_ctx->done_monitor);
+            return -1;
+        }
+        process_items(g_ctx, items, rc);
+        processed += rc;
+        used += rc;
+        used += drain_pending(g_ctx, max_items - used);
+    }
+    // Out of space with work left, or records still held back: ask to be run again
+    if (has_pending(g_ctx) || used >= max_items) return max_items;
+    return processed;
+}
+
+int plugin_queue_space(void){
+    if (!g_ctx || !g_ctx->queue) return 0;
+    return consumer_producer_space(g_ctx->queue);
+}
+
+void plugin_set_wakeup(void (*wake)(void*), void* arg){
+    g_wake = wake;
+    g_wake_arg = arg;
+}
+
+static const char* common_init(const char* (*process_function)(const char*),
+                               plugin_process_len_t process_len,
+                               plugin_process_stream_t process_stream,
                                const char* name,
                                int queue_size)
 {
     if (g_ctx) return "Plugin already initialized";
-    if (!process_function || !name || queue_size <= 0) return "Invalid parameters";
+    if ((!process_function && !process_len && !process_stream) || !name || queue_size <= 0) return "Invalid parameters";
 
     plugin_context_t* ctx = (plugin_context_t*)calloc(1, sizeof(*ctx));
     if (!ctx) return "Memory allocation failed";
@@ -94,16 +652,123 @@ const char* common_plugin_init(const char* (*process_function)(const char*),
         return err;
     }
 
+    const char* policy_name = common_plugin_option("policy");
+    if (policy_name){
+        cp_policy_t policy = CP_POLICY_BLOCK;
+        consumer_producer_parse_policy(policy_name, &policy);
+        err = consumer_producer_set_policy(ctx->queue, policy);
+        if (err){
+            consumer_producer_destroy(ctx->queue);
+            free(ctx->name);
+            free(ctx->queue);
+            free(ctx);
+            return err;
+        }
+    }
+
+    consumer_producer_set_budget(ctx->queue, g_budget);
+
+    const char* adaptive = common_plugin_option("adaptive");
+    if (adaptive && strcmp(adaptive, "on") == 0){
+        int min_capacity = 1;
+        int max_capacity = queue_size > ADAPTIVE_CAPACITY_LIMIT / ADAPTIVE_DEFAULT_GROWTH
+                         ? ADAPTIVE_CAPACITY_LIMIT : queue_size * ADAPTIVE_DEFAULT_GROWTH;
+        if (max_capacity < queue_size) max_capacity = queue_size;
+        const char* v;
+        if ((v = common_plugin_option("min_capacity"))) parse_positive_int(v, &min_capacity);
+        if ((v = common_plugin_option("max_capacity"))) parse_positive_int(v, &max_capacity);
+        err = consumer_producer_set_adaptive(ctx->queue, min_capacity, max_capacity);
+        if (err){
+            consumer_producer_destroy(ctx->queue);
+            free(ctx->name);
+            free(ctx->queue);
+            free(ctx);
+            return err;
+        }
+    }
+
     ctx->process_func = process_function;
+    ctx->process_len = process_len;
+    ctx->process_stream = process_stream;
+    ctx->flush = g_flush;
+    ctx->process_batch = g_batch;
+    if (g_batch){
+        ctx->batch = malloc(PLUGIN_BATCH_MAX * sizeof(plugin_record_t));
+        if (!ctx->batch){
+            consumer_producer_destroy(ctx->queue);
+            free(ctx->name);
+            free(ctx->queue);
+            free(ctx);
+            return "Memory allocation failed";
+        }
+    }
+
+    const char* cache_size = common_plugin_option("cache");
+    if (cache_size){
+        int entries = 0;
+        parse_positive_int(cache_size, &entries);
+        err = g_deterministic ? NULL : "Plugin output is not deterministic, cache not supported";
+        if (!err){
+            ctx->cache = malloc(sizeof(result_cache_t));
+            err = ctx->cache ? result_cache_init(ctx->cache, entries, CACHE_MAX_RECORD) : "Memory allocation failed";
+        }
+        if (err){
+            free(ctx->cache);
+            free(ctx->batch);
+            consumer_producer_destroy(ctx->queue);
+            free(ctx->name);
+            free(ctx->queue);
+            free(ctx);
+            return err;
+        }
+    }
     ctx->next_place_work = NULL;
+    ctx->next_place_slice = NULL;
     ctx->initialized = 0;
+    ctx->external = g_wake != NULL;
+    ctx->done = 0;
+    // Inline handoff relies on an idle consumer thread; pool mode has none
+    const char* handoff = common_plugin_option("handoff");
+    ctx->inline_handoff = !ctx->external && handoff && strcmp(handoff, "inline") == 0;
+    ctx->inline_items = 0;
 
-    int rc = pthread_create(&ctx->thread, NULL, plugin_consumer_thread, ctx);
-    if (rc != 0){
-        consumer_producer_destroy(ctx->queue);
-        free(ctx->name);
-        free(ctx);
-        return "Failed to create consumer thread";
+    if (ctx->external){
+        if (monitor_init(&ctx->done_monitor) != 0){
+            consumer_producer_destroy(ctx->queue);
+            if (ctx->cache) result_cache_destroy(ctx->cache);
+            free(ctx->cache);
+            free(ctx->batch);
+            free(ctx->name);
+            free(ctx->queue);
+            free(ctx);
+            return "Failed to initialize done monitor";
+        }
+        // This plugin's libc copy has never seen a thread of its own and would keep its
+        // single-threaded fast paths (unlocked malloc) while pool workers call into it.
+        // Spawning one short-lived thread switches it to multi-threaded mode for good.
+        pthread_t probe;
+        if (pthread_create(&probe, NULL, noop_thread, NULL) != 0 || pthread_join(probe, NULL) != 0){
+            monitor_destroy(&ctx->done_monitor);
+            consumer_producer_destroy(ctx->queue);
+            if (ctx->cache) result_cache_destroy(ctx->cache);
+            free(ctx->cache);
+            free(ctx->batch);
+            free(ctx->name);
+            free(ctx->queue);
+            free(ctx);
+            return "Failed to create consumer thread";
+        }
+    } else {
+        int rc = pthread_create(&ctx->thread, NULL, plugin_consumer_thread, ctx);
+        if (rc != 0){
+            consumer_producer_destroy(ctx->queue);
+            if (ctx->cache) result_cache_destroy(ctx->cache);
+            free(ctx->cache);
+            free(ctx->batch);
+            free(ctx->name);
+            free(ctx);
+            return "Failed to create consumer thread";
+        }
     }
 
     ctx->initialized = 1;
@@ -112,30 +777,81 @@ const char* common_plugin_init(const char* (*process_function)(const char*),
     return NULL;
 }
 
+const char* common_plugin_init(const char* (*process_function)(const char*),
+                               const char* name,
+                               int queue_size)
+{
+    if (!process_function) return "Invalid parameters";
+    return common_init(process_function, NULL, NULL, name, queue_size);
+}
+
+const char* common_plugin_init_len(plugin_process_len_t process_len, const char* name, int queue_size){
+    if (!process_len) return "Invalid parameters";
+    return common_init(NULL, process_len, NULL, name, queue_size);
+}
+
+const char* common_plugin_init_stream(plugin_process_stream_t process_stream, const char* name, int queue_size){
+    if (!process_stream) return "Invalid parameters";
+    return common_init(NULL, NULL, process_stream, name, queue_size);
+}
+
 const char* plugin_place_work(const char* str){
-    if (!g_ctx || !g_ctx->initialized) return "Plugin not initialized";
     if (!str) return "Invalid string parameter";
+    return plugin_place_slice(str, strlen(str), 0);
+}
+
+const char* plugin_place_slice(const char* data, size_t len, unsigned flags){
+    if (!g_ctx || !g_ctx->initialized) return "Plugin not initialized";
+    if (!data) return "Invalid string parameter";
 
-    if (strcmp(str, SENTINEL_END) == 0){
+    // A chunk that happens to read "<END>" is data, not the sentinel
+    if (!(flags & CP_ITEM_CHUNK_MASK) && len == sizeof(SENTINEL_END) - 1 && memcmp(data, SENTINEL_END, len) == 0){
         // Signal queue completion; consumer will forward SENTINEL after draining
         consumer_producer_signal_finished(g_ctx->queue);
+        if (g_ctx->external) g_wake(g_wake_arg);
+        return NULL;
+    }
+
+    // Run-to-completion: an idle consumer with nothing queued means we can do its
+    // work on this thread and skip the enqueue + wakeup; under load fall back to queuing
+    if (g_ctx->inline_handoff && consumer_producer_try_claim(g_ctx->queue)){
+        adopt_foreign_thread();
+        process_record(g_ctx, data, len, flags);
+        g_ctx->inline_items++;
+        // Nothing else is queued behind an inline item; flush while we still own the stage
+        if (g_ctx->flush) g_ctx->flush(0);
+        consumer_producer_release_claim(g_ctx->queue);
         return NULL;
     }
 
-    const char* err = consumer_producer_put(g_ctx->queue, str);
+    const char* err = consumer_producer_put_slice(g_ctx->queue, data, len, flags);
     if (err) log_error(g_ctx, err);
+    else if (g_ctx->external) g_wake(g_wake_arg);
     return err;
 }
 
 void plugin_attach(const char* (*next_place_work)(const char*)){
     if (!g_ctx) return;
     g_ctx->next_place_work = next_place_work;
+    // A plain attach replaces any earlier slice attachment
+    g_ctx->next_place_slice = NULL;
+}
+
+void plugin_attach_slice(const char* (*next_place_slice)(const char*, size_t, unsigned)){
+    if (!g_ctx) return;
+    g_ctx->next_place_slice = next_place_slice;
 }
 
 const char* plugin_wait_finished(void){
     if (!g_ctx || !g_ctx->initialized) return "Plugin not initialized";
-    int rc = pthread_join(g_ctx->thread, NULL);
-    if (rc != 0) return "pthread_join failed";
+    if (g_ctx->external){
+        // The scheduler signals done_monitor once plugin_run() has forwarded the sentinel
+        if (monitor_wait(&g_ctx->done_monitor) != 0) return "monitor_wait failed";
+        monitor_destroy(&g_ctx->done_monitor);
+    } else {
+        int rc = pthread_join(g_ctx->thread, NULL);
+        if (rc != 0) return "pthread_join failed";
+    }
     g_ctx->initialized = 0;
     return NULL;
 }
@@ -150,15 +866,76 @@ const char* plugin_fini(void){
     }
 
     if (g_ctx->queue){
+        consumer_producer_t* q = g_ctx->queue;
+        if (q->dropped_newest || q->dropped_oldest || q->spilled){
+            char msg[160];
+            snprintf(msg, sizeof(msg), "Backpressure: dropped %lu newest, %lu oldest, spilled %lu",
+                     q->dropped_newest, q->dropped_oldest, q->spilled);
+            log_info(g_ctx, msg);
+        }
+        if (q->refill_failures){
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Spill: %lu read-backs failed to allocate memory and were retried",
+                     q->refill_failures);
+            log_error(g_ctx, msg);
+        }
+        if (g_ctx->inline_handoff){
+            char msg[96];
+            snprintf(msg, sizeof(msg), "Inline handoff: %lu items processed on the producer thread",
+                     g_ctx->inline_items);
+            log_info(g_ctx, msg);
+        }
+        if (g_ctx->cache){
+            char msg[160];
+            result_cache_t* c = g_ctx->cache;
+            snprintf(msg, sizeof(msg), "Result cache: %lu hits, %lu misses, %lu evictions (%d entries)",
+                     c->hits, c->misses, c->evictions, c->capacity);
+            log_info(g_ctx, msg);
+        }
+        if (g_ctx->reassembled){
+            char msg[96];
+            snprintf(msg, sizeof(msg), "Chunked records: %lu reassembled for processing", g_ctx->reassembled);
+            log_info(g_ctx, msg);
+        }
+        if (q->adaptive){
+            char msg[160];
+            snprintf(msg, sizeof(msg), "Adaptive queue: final capacity %d after %lu resizes, producers blocked %.3f ms",
+                     q->capacity, q->resizes, q->blocked_ns / 1e6);
+            log_info(g_ctx, msg);
+        }
         consumer_producer_destroy(g_ctx->queue);
         free(g_ctx->queue);
         g_ctx->queue = NULL;
     }
 
+    // Flush the summaries above before the stage is gone; a shared ring is the host's to stop
+    if (atomic_load(&g_own_log_state) == OWN_LOG_RUNNING) log_ring_stop(&g_own_log);
+    atomic_store(&g_own_log_state, OWN_LOG_IDLE);
+
+    for (int i = g_ctx->pending_head; i < g_ctx->num_pending; i++) free(g_ctx->pending[i].data);
+    free(g_ctx->pending);
+    free(g_ctx->assembly);
+    free(g_ctx->batch);
+    free(g_ctx->batch_scratch);
+    if (g_ctx->cache){
+        result_cache_destroy(g_ctx->cache);
+        free(g_ctx->cache);
+    }
     free(g_ctx->name);
     g_ctx->name = NULL;
 
     free(g_ctx);
     g_ctx = NULL;
+    g_budget = NULL;
+    g_wake = NULL;
+    g_wake_arg = NULL;
+    g_flush = NULL;
+    g_batch = NULL;
+    g_deterministic = 0;
+    trace_attach(NULL, -1);
+    g_counters = NULL;
+    g_counters_stage = -1;
+    g_shared_log = NULL;
+    free_options();
     return NULL;
 }
@@ -1,14 +1,92 @@
 #ifndef PLUGIN_COMMON_H
 #define PLUGIN_COMMON_H
 #include "consumer_producer.h"
+#include "log_ring.h"
+#include "result_cache.h"
+#include "perf_counters.h"
+
+/**
+* Length-aware processing function. Input is not necessarily NUL-terminated.
+* Returns a heap buffer (NUL-terminated, length in *out_len) that the caller
+* frees, the input pointer itself to pass the record through unchanged, or
+* NULL to drop the record.
+*/
+typedef const char* (*plugin_process_len_t)(const char* data, size_t len, size_t* out_len);
+
+/* Position of a piece within its record, passed to streaming plugins.
+ * A record that was not split arrives as one piece with both bits set. */
+#define PLUGIN_CHUNK_BEGIN 0x1u
+#define PLUGIN_CHUNK_END   0x2u
+
+/**
+* Streaming processing function: like plugin_process_len_t, but called once per
+* chunk of a split record, in order, with PLUGIN_CHUNK_* describing where the
+* chunk sits. Each result is forwarded as the matching chunk downstream; NULL
+* forwards an empty chunk so the record stays well-formed.
+*/
+typedef const char* (*plugin_process_stream_t)(const char* data, size_t len, unsigned chunk, size_t* out_len);
+
+/* Most records a stage takes off its queue and hands to a batch function at once */
+#define PLUGIN_BATCH_MAX 64
+
+/**
+* One record of a batch. On entry out points at len + 1 bytes of scratch owned
+* by plugin_common. The plugin writes at most len bytes there and sets out_len,
+* points out at data to pass the record through unchanged, or sets out to NULL
+* to drop the record.
+*/
+typedef struct {
+    const char* data;       /* Input bytes, not necessarily NUL-terminated */
+    size_t len;
+    char* out;
+    size_t out_len;
+} plugin_record_t;
+
+/* External mode: a record forwarded beyond the downstream space granted to plugin_run() */
+typedef struct {
+    char* data;             /* Heap copy, NUL-terminated */
+    size_t len;
+    unsigned flags;         /* CP_ITEM_CHUNK_* */
+} plugin_pending_t;
+
+/**
+* Batch processing function: transforms count whole records in one call, so
+* per-call setup is paid once and short records can be processed back to back.
+* Only for transforms whose output is never longer than their input.
+*/
+typedef void (*plugin_process_batch_t)(plugin_record_t* records, size_t count);
 
 typedef struct {
     char* name;
     consumer_producer_t* queue;
     pthread_t thread;
     const char* (*process_func)(const char*);
+    plugin_process_len_t process_len;   // set instead of process_func by common_plugin_init_len
+    plugin_process_stream_t process_stream; // set by common_plugin_init_stream
+    void (*flush)(int final);           // optional, see common_plugin_set_flush
+    plugin_process_batch_t process_batch; // optional, see common_plugin_set_batch
+    plugin_record_t* batch;             // records of the batch in progress
+    char* batch_scratch;                // output space for the batch
+    size_t batch_scratch_cap;
+    result_cache_t* cache;              // optional memo of whole-record results, stage option cache=N
     const char* (*next_place_work)(const char*);
+    const char* (*next_place_slice)(const char*, size_t, unsigned);
     int initialized;
+    int external;               // driven by plugin_run() from a scheduler, no own thread
+    int done;                   // external mode: sentinel forwarded
+    monitor_t done_monitor;     // external mode: signalled when done
+    int final_flushed;          // external mode: flush(1) has run
+    plugin_pending_t* pending;  // external mode: records held back until downstream has space
+    int pending_head;           // first record not yet forwarded
+    int num_pending;
+    int cap_pending;
+    int inline_handoff;         // run process_func on the producer thread when the consumer is idle
+    unsigned long inline_items; // items handled inline
+    char* assembly;             // non-streaming stages: chunks of the record being reassembled
+    size_t assembly_len;
+    size_t assembly_cap;
+    int assembling;             // a BEGIN chunk has been seen, END not yet
+    unsigned long reassembled;  // records rebuilt from chunks
 } plugin_context_t;
 
 /**
@@ -29,6 +107,79 @@ void* plugin_consumer_thread(void* arg);
 const char* common_plugin_init(const char* (*process_function)(const char*),
 const char* name, int queue_size);
 
+/**
+* Like common_plugin_init, for plugins that work on length-delimited records.
+* Borrowed input slices reach such plugins without being copied.
+* @param process_len Plugin-specific length-aware processing function
+* @param name Plugin name
+* @param queue_size Maximum number of items that can be queued
+* @return NULL on success, error message on failure
+*/
+const char* common_plugin_init_len(plugin_process_len_t process_len, const char* name, int queue_size);
+
+/**
+* Like common_plugin_init_len, for plugins that can work on a record chunk by
+* chunk. Large records split by ingest then flow through the stage without
+* being reassembled; stages initialized otherwise rebuild whole records first.
+* @param process_stream Plugin-specific streaming processing function
+* @param name Plugin name
+* @param queue_size Maximum number of items that can be queued
+* @return NULL on success, error message on failure
+*/
+const char* common_plugin_init_stream(plugin_process_stream_t process_stream, const char* name, int queue_size);
+
+/**
+* Register a hook run on the stage's thread whenever its queue runs empty
+* (final == 0) and once more before <END> is forwarded (final != 0). Lets
+* plugins batch output and push it out when they go idle. Call before
+* common_plugin_init / common_plugin_init_len.
+* @param flush Hook, NULL to clear
+*/
+void common_plugin_set_flush(void (*flush)(int final));
+
+/**
+* Register a batch function used for every whole record. The stage then drains
+* up to PLUGIN_BATCH_MAX queued records per lock and passes them in one call;
+* chunks of split records still go to the function given at init (streaming
+* plugins) or are reassembled first. Call before common_plugin_init*.
+* @param process_batch Batch function, NULL to clear
+*/
+void common_plugin_set_batch(plugin_process_batch_t process_batch);
+
+/**
+* Declare that the plugin's output for a whole record depends only on that
+* record's bytes. Only such plugins accept the cache=N stage option, which
+* memoizes results for repeated records. Call before common_plugin_init*.
+*/
+void common_plugin_set_deterministic(void);
+
+/**
+* Forward an extra record to the next stage. For plugins whose output is not
+* one record per input, e.g. aggregates; call only from the process function
+* or the flush hook. Does nothing on the last stage. Under an external
+* scheduler the record is held in the stage until the downstream queue has
+* room, so the calling worker never blocks.
+* @param data Record bytes, NUL-terminated at data[len]; copied before return
+* @param len Number of bytes
+*/
+void common_plugin_emit(const char* data, size_t len);
+
+/**
+* log_error / log_info for the plugin's own stage, for plugin code that has
+* no context at hand. Call after common_plugin_init*; until then the line is
+* attributed to an unknown stage.
+* @param message Message text
+*/
+void common_plugin_log_error(const char* message);
+void common_plugin_log_info(const char* message);
+
+/**
+* Look up a per-stage option previously set through plugin_configure
+* @param key Option name
+* @return The most recently configured value, or NULL if unset
+*/
+const char* common_plugin_option(const char* key);
+
 /**
 * Get the plugin's name
 * @return The plugin's name (should not be modified or freed)
@@ -36,6 +187,82 @@ const char* name, int queue_size);
 __attribute__((visibility("default")))
 const char* plugin_get_name(void);
 
+/**
+* Set a per-stage option before plugin_init. Options understood by the
+* common layer are validated here; others are kept for the plugin itself.
+*   policy=block|drop-newest|drop-oldest|spill  behaviour when the queue is full
+*   handoff=queue|inline                        run work on the producer thread when idle
+*   adaptive=on|off                             resize the queue from observed load
+*   min_capacity=N, max_capacity=N              adaptive bounds (items)
+* @param key Option name
+* @param value Option value
+* @return NULL on success, error message on failure
+*/
+__attribute__((visibility("default")))
+const char* plugin_configure(const char* key, const char* value);
+
+/**
+* Share the pipeline-wide byte budget with this stage before plugin_init.
+* The stage queue charges queued bytes against it.
+* @param budget Budget owned by the caller; must outlive the plugin
+*/
+__attribute__((visibility("default")))
+void plugin_set_budget(mem_budget_t* budget);
+
+/**
+* Record this stage's processing and queue waits into an execution trace.
+* Call before plugin_init so the consumer thread is named on the timeline.
+* @param trace Trace owned by the analyzer (NULL disables recording)
+* @param stage Index of this stage in the pipeline
+*/
+__attribute__((visibility("default")))
+void plugin_set_trace(trace_t* trace, int stage);
+
+/**
+* Measure this stage's consumer thread with performance counters. Call before
+* plugin_init; the thread adds its counts to the stage's totals as it exits.
+* Stages driven by an external scheduler are not measured.
+* @param counters Counters owned by the analyzer (NULL disables measuring)
+* @param stage Index of this stage in the pipeline
+*/
+__attribute__((visibility("default")))
+void plugin_set_counters(perf_counters_t* counters, int stage);
+
+/**
+* Write this stage's log lines into a ring shared by the whole pipeline
+* instead of starting a drain thread of its own. Call before plugin_init.
+* @param log Ring owned by the caller, started and stopped by it; must outlive the plugin
+*/
+__attribute__((visibility("default")))
+void plugin_set_log(log_ring_t* log);
+
+/**
+* Hand this stage to an external scheduler before plugin_init. No consumer
+* thread is started; wake(arg) is called whenever work or the finished signal
+* arrives, and the scheduler then calls plugin_run().
+* @param wake Callback invoked from the producing thread
+* @param arg Opaque argument passed to wake
+*/
+__attribute__((visibility("default")))
+void plugin_set_wakeup(void (*wake)(void*), void* arg);
+
+/**
+* Process up to max_items queued items on the calling thread (scheduler mode).
+* Must not be called concurrently for the same plugin.
+* @param max_items Upper bound on items processed in this call
+* @return Number of items processed, or -1 once the queue is finished and the
+*         sentinel has been forwarded
+*/
+__attribute__((visibility("default")))
+int plugin_run(int max_items);
+
+/**
+* Number of items that can be placed without blocking
+* @return Free queue slots (INT_MAX for non-blocking policies)
+*/
+__attribute__((visibility("default")))
+int plugin_queue_space(void);
+
 /**
 * Initialize the plugin with the specified queue size - calls
 common_plugin_init
@@ -62,6 +289,25 @@ new memory)
 __attribute__((visibility("default")))
 const char* plugin_place_work(const char* str);
 
+/**
+* Place a length-delimited record into the plugin's queue
+* @param data Record bytes (need not be NUL-terminated)
+* @param len Number of bytes
+* @param flags CP_ITEM_BORROWED if data outlives the pipeline and may be queued
+*              without copying (e.g. an mmap'ed input file)
+* @return NULL on success, error message on failure
+*/
+__attribute__((visibility("default")))
+const char* plugin_place_slice(const char* data, size_t len, unsigned flags);
+
+/**
+* Attach this plugin to the next plugin's plugin_place_slice; takes
+* precedence over plugin_attach for forwarding records
+* @param next_place_slice Function pointer to the next plugin's place_slice
+*/
+__attribute__((visibility("default")))
+void plugin_attach_slice(const char* (*next_place_slice)(const char*, size_t, unsigned));
+
 /**
 * Attach this plugin to the next plugin in the chain
 * @param next_place_work Function pointer to the next plugin's place_work
@@ -80,7 +326,9 @@ __attribute__((visibility("default")))
 const char* plugin_wait_finished(void);
 
 /**
-* Print error message in the format [ERROR][Plugin Name] - message
+* Print error message in the format [ERROR][Plugin Name] - message.
+* Never blocks: while the stage runs, lines go through a ring drained by a
+* background thread (rate limited, identical lines folded).
 * @param context Plugin context
 * @param message Error message
 */
@@ -1,6 +1,13 @@
 #ifndef PLUGIN_COMMON_H
 #define PLUGIN_COMMON_H
 
+#include <stddef.h>
+
+/* Host-owned structures handed to the optional exports below */
+struct mem_budget;
+struct trace;
+struct perf_counters;
+struct log_ring;
 
 /**
 * Get the plugin's name
@@ -8,6 +15,61 @@
 */
 const char* plugin_get_name(void);
 
+/**
+* Optional: set a per-stage option (key=value) before plugin_init
+* @param key Option name
+* @param value Option value
+* @return NULL on success, error message on failure
+*/
+const char* plugin_configure(const char* key, const char* value);
+
+/**
+* Optional: charge the stage queue against a pipeline-wide byte budget
+* @param budget Budget owned by the caller; must outlive the plugin
+*/
+void plugin_set_budget(struct mem_budget* budget);
+
+/**
+* Optional: record processing and queue waits into an execution trace
+* @param trace Trace owned by the caller (NULL disables recording)
+* @param stage Index of this stage in the pipeline
+*/
+void plugin_set_trace(struct trace* trace, int stage);
+
+/**
+* Optional: measure the stage's consumer thread with performance counters
+* @param counters Counters owned by the caller (NULL disables measuring)
+* @param stage Index of this stage in the pipeline
+*/
+void plugin_set_counters(struct perf_counters* counters, int stage);
+
+/**
+* Optional: write log lines into a ring shared by the pipeline instead of a
+* drain thread per stage
+* @param log Ring owned by the caller; must outlive the plugin
+*/
+void plugin_set_log(struct log_ring* log);
+
+/**
+* Optional: run without a dedicated thread; wake(arg) is called when work arrives
+* @param wake Callback invoked from the producing thread
+* @param arg Opaque argument passed to wake
+*/
+void plugin_set_wakeup(void (*wake)(void*), void* arg);
+
+/**
+* Optional (scheduler mode): process up to max_items queued items
+* @param max_items Upper bound on items processed in this call
+* @return Number of items processed, or -1 once finished
+*/
+int plugin_run(int max_items);
+
+/**
+* Optional: number of items that can be placed without blocking
+* @return Free queue slots
+*/
+int plugin_queue_space(void);
+
 /**
 * Initialize the plugin with the specified queue size
 * @param queue_size Maximum number of items that can be queued
@@ -29,6 +91,22 @@ new memory)
 */
 const char* plugin_place_work(const char* str);
 
+/**
+* Optional: place a length-delimited record (bit 0 of flags: data is borrowed
+* and outlives the pipeline, so it may be queued without copying)
+* @param data Record bytes
+* @param len Number of bytes
+* @param flags Record flags
+* @return NULL on success, error message on failure
+*/
+const char* plugin_place_slice(const char* data, size_t len, unsigned flags);
+
+/**
+* Optional: forward records to the next plugin's plugin_place_slice
+* @param next_place_slice Function pointer to the next plugin's place_slice
+*/
+void plugin_attach_slice(const char* (*next_place_slice)(const char*, size_t, unsigned));
+
 /**
 * Attach this plugin to the next plugin in the chain
 * @param next_place_work Function pointer to the next plugin's place_work
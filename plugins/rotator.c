@@ -3,25 +3,45 @@
 #include <stdlib.h>
 
 // Plugin-specific processing function
-static const char* rotator_process(const char* str) 
+static const char* rotator_process(const char* str, size_t len, size_t* out_len) 
 {
     if (!str) return NULL;
 
-    size_t len = strlen(str);
-    if (len == 0) return strdup("");
-
     char* result = malloc(len + 1);
     if (!result) return NULL;
+    *out_len = len;
+    if (len == 0)
+    {
+        result[0] = '\0';
+        return result;
+    }
 
     result[0] = str[len -1];
-    for (size_t i = 0; i < len -1 ; i++) result[i+1] = str[i];
+    memcpy(result + 1, str, len - 1);
     
     result[len] = '\0';
     return result;
 }
 
+// Batch path: rotate each record into the scratch space provided
+static void rotator_batch(plugin_record_t* records, size_t count)
+{
+    for (size_t r = 0; r < count; r++)
+    {
+        size_t len = records[r].len;
+        if (len > 0)
+        {
+            records[r].out[0] = records[r].data[len - 1];
+            memcpy(records[r].out + 1, records[r].data, len - 1);
+        }
+        records[r].out_len = len;
+    }
+}
+
 // Plugin initialization (new API)
 const char* plugin_init(int queue_size) 
 {
-    return common_plugin_init(rotator_process, "rotator", queue_size);
+    common_plugin_set_deterministic();
+    common_plugin_set_batch(rotator_batch);
+    return common_plugin_init_len(rotator_process, "rotator", queue_size);
 }
\ No newline at end of file
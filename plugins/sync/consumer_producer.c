@@ -1,27 +1,52 @@
 #include "consumer_producer.h"
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <limits.h>
+
+// Adaptive sizing: grow once producers have been blocked this long within a window
+#define CP_ADAPT_GROW_BLOCKED_NS 1000000ULL
+// Adaptive sizing: or once producers checking for space have found the ring full this often
+// within a window; a pool stage parks on a full queue instead of blocking in put
+#define CP_ADAPT_GROW_FULL_CHECKS 8
+// Adaptive sizing: a window spans this many gets per slot of capacity
+#define CP_ADAPT_WINDOW_FACTOR 4
+// Pause before retrying a spill read-back that failed to allocate
+#define CP_REFILL_RETRY_NS 1000000L
 
 const char* consumer_producer_init(consumer_producer_t* queue, int capacity) 
 {
     if (!queue || capacity <= 0) return "Invalid parameters";
     
-    // Allocate items array
-    queue->items = malloc(capacity * sizeof(char*));
+    // Allocate items array (all slots start empty)
+    queue->items = calloc(capacity, sizeof(cp_item_t));
     if (!queue->items) return "Memory allocation failed";
     
-    // Initialize all items to NULL
-    for (int i = 0; i < capacity; i++) 
-    {
-        queue->items[i] = NULL;
-    }
-    
     // Initialize queue state
     queue->capacity = capacity;
     queue->count = 0;
     queue->head = 0;
     queue->tail = 0;
     queue->finished = 0;
+    queue->policy = CP_POLICY_BLOCK;
+    queue->spill = NULL;
+    queue->dropped_newest = 0;
+    queue->dropped_oldest = 0;
+    queue->spilled = 0;
+    queue->refill_failures = 0;
+    queue->adaptive = 0;
+    queue->min_capacity = capacity;
+    queue->max_capacity = capacity;
+    queue->window_gets = 0;
+    queue->window_peak = 0;
+    queue->window_blocked_ns = 0;
+    queue->window_full = 0;
+    queue->blocked_ns = 0;
+    queue->full_since_ns = 0;
+    queue->resizes = 0;
+    queue->budget = NULL;
+    queue->consumer_waiting = 0;
+    queue->claimed = 0;
 
     // Initialize mutex
     if (pthread_mutex_init(&queue->mutex, NULL) != 0)
@@ -57,6 +82,21 @@ const char* consumer_producer_init(consumer_producer_t* queue, int capacity)
     return NULL;
 }
 
+// Bytes an item is charged against the budget; borrowed slices hold no heap memory
+static size_t cp_item_charge(const cp_item_t* item)
+{
+    return (item->flags & CP_ITEM_BORROWED) ? 0 : mem_budget_item_size(item->len);
+}
+
+// Drop an item that will never be delivered. Caller holds queue->mutex (or owns the queue).
+static void cp_item_discard(consumer_producer_t* queue, cp_item_t* item)
+{
+    if (!item->data) return;
+    mem_budget_release(queue->budget, cp_item_charge(item));
+    if (!(item->flags & CP_ITEM_BORROWED)) free(item->data);
+    item->data = NULL;
+}
+
 void consumer_producer_destroy(consumer_producer_t* queue) 
 {
     if (!queue) return;
@@ -65,10 +105,7 @@ void consumer_producer_destroy(consumer_producer_t* queue)
     for (int i = 0; i < queue->count; i++) 
     {
         int index = (queue->head + i) % queue->capacity;
-        if (queue->items[index]) 
-        {
-            free(queue->items[index]);
-        }
+        cp_item_discard(queue, &queue->items[index]);
     }
     
     // Free items array
@@ -81,6 +118,13 @@ void consumer_producer_destroy(consumer_producer_t* queue)
         queue->tail = 0;
     }
     
+    if (queue->spill)
+    {
+        spill_destroy(queue->spill);
+        free(queue->spill);
+        queue->spill = NULL;
+    }
+
     // Destroy monitors
     monitor_destroy(&queue->not_full_monitor);
     monitor_destroy(&queue->not_empty_monitor);
@@ -90,9 +134,152 @@ void consumer_producer_destroy(consumer_producer_t* queue)
     pthread_mutex_destroy(&queue->mutex);
 }
 
+// Records still on disk, waiting for ring slots. Caller holds queue->mutex.
+static size_t spill_backlog(const consumer_producer_t* queue)
+{
+    return queue->spill ? queue->spill->records : 0;
+}
+
+// Move spilled records back into free ring slots; oldest first so disk order is preserved.
+// A record that cannot be allocated stays on disk for a later retry.
+// Caller holds queue->mutex.
+static void spill_refill(consumer_producer_t* queue)
+{
+    while (spill_backlog(queue) > 0 && queue->count < queue->capacity)
+    {
+        size_t len;
+        unsigned flags = 0;
+        char* spilled = spill_pop(queue->spill, &len, &flags);
+        if (!spilled)
+        {
+            queue->refill_failures++;
+            return;
+        }
+        mem_budget_charge(queue->budget, mem_budget_item_size(len));
+        queue->items[queue->tail].data = spilled;
+        queue->items[queue->tail].len = len;
+        queue->items[queue->tail].flags = flags;
+        queue->tail = (queue->tail + 1) % queue->capacity;
+        queue->count++;
+    }
+}
+
+static unsigned long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+// Reallocate the ring to new_capacity, compacting items to start at index 0.
+// Caller holds queue->mutex and guarantees new_capacity >= count.
+static int cp_resize(consumer_producer_t* queue, int new_capacity)
+{
+    cp_item_t* items = calloc(new_capacity, sizeof(cp_item_t));
+    if (!items) return -1;
+
+    for (int i = 0; i < queue->count; i++) items[i] = queue->items[(queue->head + i) % queue->capacity];
+
+    free(queue->items);
+    queue->items = items;
+    queue->capacity = new_capacity;
+    queue->head = 0;
+    queue->tail = queue->count % new_capacity;
+    queue->resizes++;
+    return 0;
+}
+
+// Producers keep stalling: trade memory for throughput, up to the limit.
+// Caller holds queue->mutex. Returns 1 if the ring grew.
+static int cp_adapt_grow(consumer_producer_t* queue)
+{
+    if (!queue->adaptive || queue->capacity >= queue->max_capacity) return 0;
+    if (queue->window_blocked_ns < CP_ADAPT_GROW_BLOCKED_NS && queue->window_full < CP_ADAPT_GROW_FULL_CHECKS)
+    {
+        return 0;
+    }
+    int target = queue->capacity * 2;
+    if (target > queue->max_capacity || target < queue->capacity) target = queue->max_capacity;
+    if (cp_resize(queue, target) != 0) return 0;
+    queue->window_blocked_ns = 0;
+    queue->window_full = 0;
+    return 1;
+}
+
+// Close the current observation window; shrink if the ring stayed mostly empty
+// and no producer had to wait. Caller holds queue->mutex.
+static void cp_adapt_window(consumer_producer_t* queue)
+{
+    if (queue->window_peak * 4 <= queue->capacity && queue->window_blocked_ns == 0 && queue->window_full == 0 &&
+        queue->capacity > queue->min_capacity)
+    {
+        int target = queue->capacity / 2;
+        if (target < queue->min_capacity) target = queue->min_capacity;
+        if (target >= queue->count) cp_resize(queue, target);
+    }
+    queue->window_gets = 0;
+    queue->window_peak = 0;
+    queue->window_blocked_ns = 0;
+    queue->window_full = 0;
+}
+
+const char* consumer_producer_set_adaptive(consumer_producer_t* queue, int min_capacity, int max_capacity)
+{
+    if (!queue || min_capacity <= 0 || max_capacity < min_capacity) return "Invalid parameters";
+    if (queue->capacity < min_capacity || queue->capacity > max_capacity) return "Capacity outside adaptive range";
+
+    queue->adaptive = 1;
+    queue->min_capacity = min_capacity;
+    queue->max_capacity = max_capacity;
+    return NULL;
+}
+
+void consumer_producer_set_budget(consumer_producer_t* queue, mem_budget_t* budget)
+{
+    if (!queue) return;
+    queue->budget = budget;
+}
+
+const char* consumer_producer_set_policy(consumer_producer_t* queue, cp_policy_t policy)
+{
+    if (!queue) return "Invalid parameters";
+
+    if (policy == CP_POLICY_SPILL && !queue->spill)
+    {
+        spill_segment_t* spill = malloc(sizeof(*spill));
+        if (!spill) return "Memory allocation failed";
+        const char* err = spill_init(spill);
+        if (err)
+        {
+            free(spill);
+            return err;
+        }
+        queue->spill = spill;
+    }
+    queue->policy = policy;
+    return NULL;
+}
+
+int consumer_producer_parse_policy(const char* name, cp_policy_t* policy)
+{
+    if (!name || !policy) return -1;
+    if (strcmp(name, "block") == 0) *policy = CP_POLICY_BLOCK;
+    else if (strcmp(name, "drop-newest") == 0) *policy = CP_POLICY_DROP_NEWEST;
+    else if (strcmp(name, "drop-oldest") == 0) *policy = CP_POLICY_DROP_OLDEST;
+    else if (strcmp(name, "spill") == 0) *policy = CP_POLICY_SPILL;
+    else return -1;
+    return 0;
+}
+
 const char* consumer_producer_put(consumer_producer_t* queue, const char* item) 
 {
-    if (!queue || !item) return "Invalid parameters";
+    if (!item) return "Invalid parameters";
+    return consumer_producer_put_slice(queue, item, strlen(item), 0);
+}
+
+const char* consumer_producer_put_slice(consumer_producer_t* queue, const char* data, size_t len, unsigned flags)
+{
+    if (!queue || !data) return "Invalid parameters";
     
     pthread_mutex_lock(&queue->mutex);
     
@@ -102,16 +289,52 @@ const char* consumer_producer_put(consumer_producer_t* queue, const char* item)
         pthread_mutex_unlock(&queue->mutex);
         return "Queue is finished";
     }
+
+    // Once anything has spilled, later items follow it to disk to keep FIFO order
+    if (queue->policy == CP_POLICY_SPILL &&
+        (queue->spill->records > 0 || queue->count >= queue->capacity))
+    {
+        // The segment holds a copy, so the record is owned once read back
+        const char* err = spill_append(queue->spill, data, len, flags & ~CP_ITEM_BORROWED);
+        if (!err) queue->spilled++;
+        pthread_mutex_unlock(&queue->mutex);
+        return err;
+    }
+
+    if (queue->count >= queue->capacity && queue->policy == CP_POLICY_DROP_NEWEST)
+    {
+        queue->dropped_newest++;
+        pthread_mutex_unlock(&queue->mutex);
+        return NULL;
+    }
+
+    if (queue->count >= queue->capacity && queue->policy == CP_POLICY_DROP_OLDEST)
+    {
+        cp_item_discard(queue, &queue->items[queue->head]);
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        queue->dropped_oldest++;
+    }
     
     // Wait for space in queue
     while (queue->count >= queue->capacity && !queue->finished)     
     {
+        if (cp_adapt_grow(queue)) break;
+
+        // This wait is timed below; do not count it again from consumer_producer_space
+        queue->full_since_ns = 0;
         monitor_reset(&queue->not_full_monitor);
         pthread_mutex_unlock(&queue->mutex);
+        unsigned long long start = now_ns();
+        uint64_t traced = trace_begin();
         if (monitor_wait(&queue->not_full_monitor) != 0) {
             return "Monitor wait failed";
         }
+        trace_end(TRACE_PUT_WAIT, traced);
+        unsigned long long waited = now_ns() - start;
         pthread_mutex_lock(&queue->mutex);
+        queue->window_blocked_ns += waited;
+        queue->blocked_ns += waited;
     }
 
     // Recheck finished state after reacquiring lock
@@ -120,16 +343,23 @@ const char* consumer_producer_put(consumer_producer_t* queue, const char* item)
             return "Queue is finished";
         }
     
-    // Allocate and copy the string
-    char* item_copy = strdup(item);
-    if (!item_copy) 
+    cp_item_t item = { (char*)data, len, flags };
+    if (!(flags & CP_ITEM_BORROWED))
     {
-        pthread_mutex_unlock(&queue->mutex);
-        return "Memory allocation failed";
+        // Allocate and copy the bytes (always NUL-terminated for string consumers)
+        item.data = malloc(len + 1);
+        if (!item.data) 
+        {
+            pthread_mutex_unlock(&queue->mutex);
+            return "Memory allocation failed";
+        }
+        memcpy(item.data, data, len);
+        item.data[len] = '\0';
     }
+    mem_budget_charge(queue->budget, cp_item_charge(&item));
     
     // Add to queue
-    queue->items[queue->tail] = item_copy;
+    queue->items[queue->tail] = item;
     queue->tail = (queue->tail + 1) % queue->capacity;
     queue->count++;
     
@@ -140,50 +370,193 @@ const char* consumer_producer_put(consumer_producer_t* queue, const char* item)
     return NULL;
 }
 
+// Remove the head item. Caller holds queue->mutex and guarantees count > 0.
+static cp_item_t cp_take_locked(consumer_producer_t* queue)
+{
+    if (queue->count > queue->window_peak) queue->window_peak = queue->count;
+
+    // Get item from queue
+    cp_item_t item = queue->items[queue->head];
+    queue->items[queue->head].data = NULL; // Clear the slot
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    mem_budget_release(queue->budget, cp_item_charge(&item));
+    spill_refill(queue);
+
+    // A producer found the ring full through consumer_producer_space and held back until now
+    if (queue->full_since_ns)
+    {
+        unsigned long long waited = now_ns() - queue->full_since_ns;
+        queue->window_blocked_ns += waited;
+        queue->blocked_ns += waited;
+        queue->full_since_ns = 0;
+    }
+
+    if (queue->adaptive && ++queue->window_gets >= queue->capacity * CP_ADAPT_WINDOW_FACTOR)
+    {
+        cp_adapt_window(queue);
+    }
+    
+    // Signal that queue is not full
+    monitor_signal(&queue->not_full_monitor);
+
+    // Transition: non-empty -> empty
+    if (queue->count == 0) {
+        monitor_reset(&queue->not_empty_monitor);
+        if (queue->finished) {
+            // If producer closed and we just drained the last item, notify waiters
+            monitor_signal(&queue->finished_monitor);
+        }
+    }
+
+    return item;
+}
+
 char* consumer_producer_get(consumer_producer_t* queue) 
 {
-    if (!queue) return NULL;
+    cp_item_t item;
+    if (!consumer_producer_get_item(queue, &item)) return NULL;
+    if (!(item.flags & CP_ITEM_BORROWED)) return item.data;
+
+    // Callers of the string API own what they get back
+    char* copy = malloc(item.len + 1);
+    if (copy)
+    {
+        memcpy(copy, item.data, item.len);
+        copy[item.len] = '\0';
+    }
+    return copy;
+}
+
+int consumer_producer_get_item(consumer_producer_t* queue, cp_item_t* item)
+{
+    return consumer_producer_get_items(queue, item, 1);
+}
+
+int consumer_producer_get_items(consumer_producer_t* queue, cp_item_t* items, int max)
+{
+    if (!queue || !items || max <= 0) return 0;
     
     pthread_mutex_lock(&queue->mutex);
+    spill_refill(queue);
     
-    // Wait for item in queue or finished signal
-    while (queue->count == 0 && !queue->finished) 
+    // Wait for item in queue or finished signal, and for any inline claim to end
+    while ((queue->count == 0 && (!queue->finished || spill_backlog(queue) > 0)) || queue->claimed) 
     {
+        // Spilled records failed to read back and no put will come to retry: do it here
+        if (queue->count == 0 && spill_backlog(queue) > 0 && !queue->claimed)
+        {
+            pthread_mutex_unlock(&queue->mutex);
+            struct timespec pause = { 0, CP_REFILL_RETRY_NS };
+            nanosleep(&pause, NULL);
+            pthread_mutex_lock(&queue->mutex);
+            spill_refill(queue);
+            continue;
+        }
         monitor_reset(&queue->not_empty_monitor);
+        queue->consumer_waiting = 1;
         pthread_mutex_unlock(&queue->mutex);
-        if (monitor_wait(&queue->not_empty_monitor) != 0) {
-            return NULL;
-        }
+        uint64_t traced = trace_begin();
+        int rc = monitor_wait(&queue->not_empty_monitor);
+        trace_end(TRACE_GET_WAIT, traced);
         pthread_mutex_lock(&queue->mutex);
+        queue->consumer_waiting = 0;
+        if (rc != 0) {
+            pthread_mutex_unlock(&queue->mutex);
+            return 0;
+        }
     }
     
-    // Return NULL if queue is empty and finished
+    // Nothing to return if queue is empty and finished
     if (queue->count == 0) {
         pthread_mutex_unlock(&queue->mutex);
-        return NULL;
+        return 0;
     }
     
-    // Get item from queue
-    char* item = queue->items[queue->head];
-    queue->items[queue->head] = NULL; // Clear the slot
-    queue->head = (queue->head + 1) % queue->capacity;
-    queue->count--;
+    int taken = 0;
+    while (taken < max && queue->count > 0) items[taken++] = cp_take_locked(queue);
+    pthread_mutex_unlock(&queue->mutex);
     
-    // Signal that queue is not full
-    monitor_signal(&queue->not_full_monitor);
+    return taken;
+}
 
-    // Transition: non-empty -> empty
-    if (queue->count == 0) {
-        monitor_reset(&queue->not_empty_monitor);
-        if (queue->finished) {
-            // If producer closed and we just drained the last item, notify waiters
-            monitor_signal(&queue->finished_monitor);
-        }
+int consumer_producer_try_get_item(consumer_producer_t* queue, cp_item_t* item)
+{
+    return consumer_producer_try_get_items(queue, item, 1);
+}
+
+int consumer_producer_try_get_items(consumer_producer_t* queue, cp_item_t* items, int max)
+{
+    if (!queue || !items || max <= 0) return -1;
+
+    pthread_mutex_lock(&queue->mutex);
+    spill_refill(queue);
+    if (queue->count == 0)
+    {
+        int finished = queue->finished && spill_backlog(queue) == 0;
+        pthread_mutex_unlock(&queue->mutex);
+        items[0].data = NULL;
+        return finished ? -1 : 0;
     }
+    int taken = 0;
+    while (taken < max && queue->count > 0) items[taken++] = cp_take_locked(queue);
+    pthread_mutex_unlock(&queue->mutex);
+    return taken;
+}
+
+int consumer_producer_space(consumer_producer_t* queue)
+{
+    if (!queue) return 0;
 
+    pthread_mutex_lock(&queue->mutex);
+    // Only the blocking policy can make a put wait
+    if (queue->policy != CP_POLICY_BLOCK)
+    {
+        pthread_mutex_unlock(&queue->mutex);
+        return INT_MAX;
+    }
+    // A producer that checks first never blocks in put, so a full ring stands in for the wait
+    if (queue->count >= queue->capacity)
+    {
+        queue->window_full++;
+        if (!cp_adapt_grow(queue) && !queue->full_since_ns) queue->full_since_ns = now_ns();
+    }
+    int space = queue->capacity - queue->count;
+    pthread_mutex_unlock(&queue->mutex);
+    return space;
+}
+
+size_t consumer_producer_backlog(consumer_producer_t* queue)
+{
+    if (!queue) return 0;
+
+    pthread_mutex_lock(&queue->mutex);
+    size_t records = spill_backlog(queue);
+    pthread_mutex_unlock(&queue->mutex);
+    return records;
+}
+
+int consumer_producer_try_claim(consumer_producer_t* queue)
+{
+    if (!queue) return 0;
+
+    pthread_mutex_lock(&queue->mutex);
+    int ok = queue->count == 0 && queue->consumer_waiting && !queue->claimed && !queue->finished &&
+             spill_backlog(queue) == 0;
+    if (ok) queue->claimed = 1;
+    pthread_mutex_unlock(&queue->mutex);
+    return ok;
+}
+
+void consumer_producer_release_claim(consumer_producer_t* queue)
+{
+    if (!queue) return;
+
+    pthread_mutex_lock(&queue->mutex);
+    queue->claimed = 0;
+    // The consumer may have been woken by a concurrent put and gone back to waiting on us
+    if (queue->count > 0 || queue->finished) monitor_signal(&queue->not_empty_monitor);
     pthread_mutex_unlock(&queue->mutex);
-    
-    return item;
 }
 
 void consumer_producer_signal_finished(consumer_producer_t* queue) 
@@ -206,7 +579,7 @@ int consumer_producer_wait_finished(consumer_producer_t* queue)
     
     pthread_mutex_lock(&queue->mutex);
     // Wait until finished flag is set
-    while (!(queue->finished && queue->count == 0)) 
+    while (!(queue->finished && queue->count == 0 && spill_backlog(queue) == 0)) 
     {
         monitor_reset(&queue->finished_monitor);
         pthread_mutex_unlock(&queue->mutex);
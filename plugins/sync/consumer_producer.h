@@ -2,6 +2,41 @@
 #define CONSUMER_PRODUCER_H
 
 #include "monitor.h"
+#include "spill.h"
+#include "mem_budget.h"
+#include "trace.h"
+
+/**
+ * What a producer does when it finds the queue full  
+ */
+typedef enum
+{
+    CP_POLICY_BLOCK = 0,    /* Wait until the consumer makes room (default) */
+    CP_POLICY_DROP_NEWEST,  /* Discard the incoming item */
+    CP_POLICY_DROP_OLDEST,  /* Evict the oldest queued item to make room */
+    CP_POLICY_SPILL         /* Append to an on-disk segment, drained back in order */
+} cp_policy_t;
+
+/**
+ * One queued record. Owned items are NUL-terminated heap copies; borrowed  
+ * items point into producer memory that outlives the queue (e.g. an mmap'ed  
+ * input file) and are neither copied nor freed.  
+ */
+typedef struct
+{
+    char* data;             /* Record bytes */
+    size_t len;             /* Number of bytes, excluding any terminator */
+    unsigned flags;         /* CP_ITEM_* */
+} cp_item_t;
+
+#define CP_ITEM_BORROWED 0x1u   /* data is not owned by the queue */
+
+/* A record split into chunks travels as BEGIN, any number of CONTINUE, then
+ * END; an item with none of these bits is a whole record */
+#define CP_ITEM_CHUNK_BEGIN    0x2u
+#define CP_ITEM_CHUNK_CONTINUE 0x4u
+#define CP_ITEM_CHUNK_END      0x8u
+#define CP_ITEM_CHUNK_MASK     (CP_ITEM_CHUNK_BEGIN | CP_ITEM_CHUNK_CONTINUE | CP_ITEM_CHUNK_END)
 
 /**
  * Consumer-Producer queue structure for thread-safe producer-consumer pattern  
@@ -9,7 +44,7 @@
  */
 typedef struct 
 {
-    char** items;           /* Array of string pointers */  
+    cp_item_t* items;       /* Ring of queued records */  
     int capacity;           /* Maximum number of items */  
     int count;              /* Current number of items */  
     int head;               /* Index of first item */  
@@ -19,6 +54,25 @@ typedef struct
     monitor_t not_empty_monitor;    /* Monitor for "not empty" state */  
     monitor_t finished_monitor;     /* Monitor for finished signal */  
     int finished;                   /* Flag indicating no more items will be produced */
+    cp_policy_t policy;             /* Behaviour when the queue is full */
+    spill_segment_t* spill;         /* Overflow segment (CP_POLICY_SPILL only) */
+    unsigned long dropped_newest;   /* Items discarded on arrival */
+    unsigned long dropped_oldest;   /* Items evicted from the head */
+    unsigned long spilled;          /* Items that overflowed to the spill segment */
+    unsigned long refill_failures;  /* Spilled items that could not be read back yet (out of memory) */
+    int adaptive;                   /* Resize the ring from observed load */
+    int min_capacity;               /* Adaptive lower bound */
+    int max_capacity;               /* Adaptive upper bound (memory limit in items) */
+    int window_gets;                /* Gets in the current observation window */
+    int window_peak;                /* Highest occupancy seen in the window */
+    unsigned long long window_blocked_ns;  /* Producer wait time in the window */
+    int window_full;                /* Times consumer_producer_space found the ring full in the window */
+    unsigned long long blocked_ns;  /* Total producer wait time */
+    unsigned long long full_since_ns;  /* When consumer_producer_space found the ring full, 0 if not */
+    unsigned long resizes;          /* Number of ring reallocations */
+    mem_budget_t* budget;           /* Shared byte budget, NULL when unlimited */
+    int consumer_waiting;           /* Consumer is parked in consumer_producer_get */
+    int claimed;                    /* A producer is running the consumer's work inline */
 } consumer_producer_t;
 
 /**
@@ -35,15 +89,72 @@ const char* consumer_producer_init(consumer_producer_t* queue, int capacity);
  */
 void consumer_producer_destroy(consumer_producer_t* queue);
 
+/**
+ * Select the full-queue policy. Must be called before the queue is shared.  
+ * @param queue Pointer to queue structure  
+ * @param policy  Policy to apply  
+ * @return  NULL on success, error message on failure  
+ */
+const char* consumer_producer_set_policy(consumer_producer_t* queue, cp_policy_t policy);
+
+/**
+ * Let the ring grow while producers keep blocking and shrink while it stays  
+ * mostly empty, never leaving [min_capacity, max_capacity].  
+ * Must be called before the queue is shared.  
+ * @param queue Pointer to queue structure  
+ * @param min_capacity  Smallest ring size  
+ * @param max_capacity  Largest ring size  
+ * @return  NULL on success, error message on failure  
+ */
+const char* consumer_producer_set_adaptive(consumer_producer_t* queue, int min_capacity, int max_capacity);
+
+/**
+ * Charge queued bytes against a shared budget (released again on get).  
+ * Must be called before the queue is shared.  
+ * @param queue Pointer to queue structure  
+ * @param budget  Budget to charge, or NULL to stop accounting  
+ */
+void consumer_producer_set_budget(consumer_producer_t* queue, mem_budget_t* budget);
+
+/**
+ * Parse a policy name: block, drop-newest, drop-oldest or spill  
+ * @param name  Policy name  
+ * @param policy  Output policy  
+ * @return  0 on success, -1 if the name is unknown  
+ */
+int consumer_producer_parse_policy(const char* name, cp_policy_t* policy);
+
 /**
  * Add an item to the queue (producer).  
- * Blocks if queue is full.  
+ * When the queue is full the configured policy applies: block (default),  
+ * drop the new or the oldest item, or spill to disk.  
  * @param queue Pointer to queue structure  
  * @param item String to add (queue takes ownership)  
  * @return  NULL on success, error message on failure  
  */
 const char* consumer_producer_put(consumer_producer_t* queue, const char* item);
 
+/**
+ * Add a length-delimited record (producer). Same blocking and policy rules  
+ * as consumer_producer_put.  
+ * @param queue Pointer to queue structure  
+ * @param data  Record bytes (may contain NULs)  
+ * @param len   Number of bytes  
+ * @param flags CP_ITEM_BORROWED to queue the pointer itself instead of a copy,  
+ *              plus CP_ITEM_CHUNK_* for chunks of a split record  
+ * @return  NULL on success, error message on failure  
+ */
+const char* consumer_producer_put_slice(consumer_producer_t* queue, const char* data, size_t len, unsigned flags);
+
+/**
+ * Remove a record from the queue (consumer). Blocks if queue is empty.  
+ * The caller frees item->data unless CP_ITEM_BORROWED is set.  
+ * @param queue Pointer to queue structure  
+ * @param item  Receives the record  
+ * @return  1 if a record was taken, 0 if the queue is finished and empty  
+ */
+int consumer_producer_get_item(consumer_producer_t* queue, cp_item_t* item);
+
 /**
  * Remove an item from the queue (consumer) and returns it.  
  * Blocks if queue is empty.  
@@ -52,6 +163,65 @@ const char* consumer_producer_put(consumer_producer_t* queue, const char* item);
  */
 char* consumer_producer_get(consumer_producer_t* queue);
 
+/**
+ * Remove a record without blocking (consumer).  
+ * @param queue Pointer to queue structure  
+ * @param item  Receives the record (same ownership rules as get_item)  
+ * @return  1 if a record was taken, 0 if empty, -1 if empty and finished  
+ */
+int consumer_producer_try_get_item(consumer_producer_t* queue, cp_item_t* item);
+
+/**
+ * Remove up to max records under a single lock acquisition (consumer).  
+ * Blocks until at least one record is available or the queue is finished.  
+ * @param queue Pointer to queue structure  
+ * @param items Receives the records in FIFO order (same ownership rules as get_item)  
+ * @param max   Capacity of items  
+ * @return  Number of records taken, 0 if the queue is finished and empty  
+ */
+int consumer_producer_get_items(consumer_producer_t* queue, cp_item_t* items, int max);
+
+/**
+ * Remove up to max records without blocking (consumer).  
+ * @param queue Pointer to queue structure  
+ * @param items Receives the records in FIFO order  
+ * @param max   Capacity of items  
+ * @return  Number of records taken, 0 if empty, -1 if empty and finished  
+ */
+int consumer_producer_try_get_items(consumer_producer_t* queue, cp_item_t* items, int max);
+
+/**
+ * Number of puts guaranteed not to block right now. Finding the ring full  
+ * counts as producer wait time until the next get, so adaptive queues also  
+ * grow for producers that check before they put (e.g. a pool scheduler).  
+ * @param queue Pointer to queue structure  
+ * @return  Free slots, or INT_MAX when the policy never blocks  
+ */
+int consumer_producer_space(consumer_producer_t* queue);
+
+/**
+ * Number of spilled records not yet moved back into the ring  
+ * @param queue Pointer to queue structure  
+ * @return  Records waiting on disk (0 unless the policy is spill)  
+ */
+size_t consumer_producer_backlog(consumer_producer_t* queue);
+
+/**
+ * Claim the consumer's role for one item (run-to-completion handoff).  
+ * Succeeds only if the queue is empty and the consumer is idle in  
+ * consumer_producer_get; until released the consumer takes no items, so  
+ * processing stays serialized and in order.  
+ * @param queue Pointer to queue structure  
+ * @return  1 if claimed, 0 if the item should be queued instead  
+ */
+int consumer_producer_try_claim(consumer_producer_t* queue);
+
+/**
+ * End a claim taken with consumer_producer_try_claim  
+ * @param queue Pointer to queue structure  
+ */
+void consumer_producer_release_claim(consumer_producer_t* queue);
+
 /**
  * Signal that processing is finished  
  * @param queue Pointer to queue structure  
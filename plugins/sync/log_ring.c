@@ -0,0 +1,253 @@
+#include "log_ring.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define LOG_RING_MASK (LOG_RING_SLOTS - 1)
+#define LOG_RING_INTERVAL_NS (1000000000ULL / LOG_RING_RATE)
+
+static void futex_wait(atomic_uint* word, unsigned expected, const struct timespec* timeout)
+{
+    syscall(SYS_futex, (unsigned*)word, FUTEX_WAIT_PRIVATE, expected, timeout, NULL, 0);
+}
+
+static void futex_wake_all(atomic_uint* word)
+{
+    syscall(SYS_futex, (unsigned*)word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Straight to the fd: the drain thread must not take the stdio lock it is meant to keep off the data path
+static void write_all(const char* data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(STDERR_FILENO, data, len);
+        if (n <= 0) return;
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static void write_notice(log_ring_t* ring, const char* fmt, unsigned long count)
+{
+    char line[LOG_RING_LINE];
+    int n = snprintf(line, sizeof(line), "[INFO][%s] - ", ring->name);
+    if (n < 0 || (size_t)n >= sizeof(line)) return;
+    int m = snprintf(line + n, sizeof(line) - (size_t)n, fmt, count);
+    if (m < 0) return;
+    size_t len = (size_t)n + (size_t)m;
+    if (len >= sizeof(line)) len = sizeof(line) - 1;
+    write_all(line, len);
+}
+
+static uint64_t line_hash(const char* level, const char* message)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (const char* p = level; *p; p++) h = (h ^ (unsigned char)*p) * 1099511628211ULL;
+    for (const char* p = message; *p; p++) h = (h ^ (unsigned char)*p) * 1099511628211ULL;
+    return h;
+}
+
+// Generic cell rate algorithm: one CAS per repeat, bursts of LOG_RING_BURST allowed.
+// A line that differs from the previous one always passes.
+static int rate_allow(log_ring_t* ring, uint64_t hash)
+{
+    // Read first: during a storm the line stays shared instead of bouncing between writers
+    if (atomic_load_explicit(&ring->last_hash, memory_order_relaxed) != hash)
+    {
+        atomic_store_explicit(&ring->last_hash, hash, memory_order_relaxed);
+        return 1;
+    }
+
+    uint64_t now = now_ns();
+    uint64_t tolerance = (LOG_RING_BURST - 1) * LOG_RING_INTERVAL_NS;
+    uint64_t tat = atomic_load_explicit(&ring->next_ns, memory_order_relaxed);
+    for (;;)
+    {
+        if (tat > now + tolerance) return 0;
+        uint64_t next = (tat > now ? tat : now) + LOG_RING_INTERVAL_NS;
+        if (atomic_compare_exchange_weak_explicit(&ring->next_ns, &tat, next,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        {
+            return 1;
+        }
+    }
+}
+
+static int ring_ready(log_ring_t* ring)
+{
+    log_slot_t* slot = &ring->slots[ring->dequeue_pos & LOG_RING_MASK];
+    return atomic_load_explicit(&slot->seq, memory_order_acquire) == ring->dequeue_pos + 1;
+}
+
+// Take the oldest published line. Drain thread only.
+static int ring_pop(log_ring_t* ring, char* line)
+{
+    if (!ring_ready(ring)) return 0;
+    log_slot_t* slot = &ring->slots[ring->dequeue_pos & LOG_RING_MASK];
+    memcpy(line, slot->line, LOG_RING_LINE);
+    atomic_store_explicit(&slot->seq, ring->dequeue_pos + LOG_RING_SLOTS, memory_order_release);
+    ring->dequeue_pos++;
+    return 1;
+}
+
+static int suppressed_pending(log_ring_t* ring)
+{
+    return atomic_load(&ring->rate_limited) + atomic_load(&ring->dropped) > ring->reported;
+}
+
+static void report_suppressed(log_ring_t* ring)
+{
+    unsigned long total = atomic_load(&ring->rate_limited) + atomic_load(&ring->dropped);
+    if (total > ring->reported)
+    {
+        write_notice(ring, "%lu log lines suppressed (rate limit or full log ring)\n", total - ring->reported);
+        ring->reported = total;
+    }
+}
+
+static void* drain_thread(void* arg)
+{
+    log_ring_t* ring = arg;
+    char line[LOG_RING_LINE];
+    char last[LOG_RING_LINE];
+    unsigned long repeats = 0;
+    uint64_t last_report = now_ns();
+    last[0] = '\0';
+
+    for (;;)
+    {
+        while (ring_pop(ring, line))
+        {
+            if (strcmp(line, last) == 0)
+            {
+                repeats++;
+                continue;
+            }
+            if (repeats) write_notice(ring, "last message repeated %lu more times\n", repeats);
+            repeats = 0;
+            write_all(line, strlen(line));
+            memcpy(last, line, LOG_RING_LINE);
+        }
+
+        // Counts of folded and refused lines go out once per interval, so a storm
+        // costs a couple of lines per second instead of one per burst
+        int stopping = atomic_load(&ring->stop);
+        uint64_t now = now_ns();
+        if (stopping || now - last_report >= LOG_RING_REPORT_MS * 1000000ULL)
+        {
+            if (repeats) write_notice(ring, "last message repeated %lu more times\n", repeats);
+            repeats = 0;
+            report_suppressed(ring);
+            last_report = now;
+        }
+        if (stopping) break;
+
+        // Sample the sequence before re-checking so a publish in between is not missed
+        atomic_store(&ring->sleeping, 1);
+        unsigned seq = atomic_load(&ring->wake_seq);
+        if (!ring_ready(ring) && !atomic_load(&ring->stop))
+        {
+            // Come back for pending counts even if nothing else is logged
+            struct timespec timeout = { LOG_RING_REPORT_MS / 1000, (LOG_RING_REPORT_MS % 1000) * 1000000L };
+            futex_wait(&ring->wake_seq, seq, repeats || suppressed_pending(ring) ? &timeout : NULL);
+        }
+        atomic_store(&ring->sleeping, 0);
+    }
+    return NULL;
+}
+
+const char* log_ring_start(log_ring_t* ring, const char* name)
+{
+    if (!ring) return "Invalid parameters";
+
+    for (size_t i = 0; i < LOG_RING_SLOTS; i++)
+    {
+        atomic_init(&ring->slots[i].seq, i);
+        ring->slots[i].line[0] = '\0';
+    }
+    atomic_init(&ring->enqueue_pos, 0);
+    ring->dequeue_pos = 0;
+    atomic_init(&ring->wake_seq, 0);
+    atomic_init(&ring->sleeping, 0);
+    atomic_init(&ring->running, 0);
+    atomic_init(&ring->stop, 0);
+    atomic_init(&ring->last_hash, 0);
+    atomic_init(&ring->next_ns, 0);
+    atomic_init(&ring->rate_limited, 0);
+    atomic_init(&ring->dropped, 0);
+    ring->reported = 0;
+    snprintf(ring->name, sizeof(ring->name), "%s", name ? name : "unknown");
+
+    if (pthread_create(&ring->thread, NULL, drain_thread, ring) != 0) return "Failed to create log thread";
+    atomic_store(&ring->running, 1);
+    return NULL;
+}
+
+int log_ring_write(log_ring_t* ring, const char* level, const char* name, const char* message)
+{
+    if (!ring || !atomic_load(&ring->running)) return -1;
+
+    if (!rate_allow(ring, line_hash(level, message)))
+    {
+        atomic_fetch_add_explicit(&ring->rate_limited, 1, memory_order_relaxed);
+        return 1;
+    }
+
+    // Claim a slot (bounded MPMC ring with per-slot turn counters)
+    size_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    log_slot_t* slot;
+    for (;;)
+    {
+        slot = &ring->slots[pos & LOG_RING_MASK];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq == pos)
+        {
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (seq < pos)
+        {
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return 1;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    int n = snprintf(slot->line, LOG_RING_LINE, "[%s][%s] - %s\n", level, name, message);
+    if (n < 0) slot->line[0] = '\0';
+    else if (n >= LOG_RING_LINE) slot->line[LOG_RING_LINE - 2] = '\n';
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+
+    atomic_fetch_add(&ring->wake_seq, 1);
+    if (atomic_load(&ring->sleeping)) futex_wake_all(&ring->wake_seq);
+    return 0;
+}
+
+void log_ring_stop(log_ring_t* ring)
+{
+    if (!ring || !atomic_load(&ring->running)) return;
+
+    atomic_store(&ring->running, 0);
+    atomic_store(&ring->stop, 1);
+    atomic_fetch_add(&ring->wake_seq, 1);
+    futex_wake_all(&ring->wake_seq);
+    pthread_join(ring->thread, NULL);
+}
@@ -0,0 +1,73 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define LOG_RING_SLOTS 256          /* power of two */
+#define LOG_RING_LINE 256           /* longer lines are truncated */
+#define LOG_RING_RATE 1000          /* sustained repeats of one line per second */
+#define LOG_RING_BURST 200          /* repeats accepted at once before the rate applies */
+#define LOG_RING_REPORT_MS 1000     /* at most one repeat / suppression notice per interval */
+
+typedef struct
+{
+    atomic_size_t seq;              /* Slot turn: position when free, position + 1 when filled */
+    char line[LOG_RING_LINE];
+} log_slot_t;
+
+/**
+ * Bounded multi-producer ring of log lines drained to stderr by a background
+ * thread, so logging never waits on the stdio lock or a slow terminal.
+ * Producers only use atomics and a futex wake. A line identical to the one
+ * before is rate limited; lines beyond the limit or arriving while the ring is
+ * full are counted instead of written, and a run of identical lines is printed
+ * once with a repeat count. The analyzer owns one ring for the whole pipeline
+ * and hands it to plugins by pointer (plugin_set_log); writers in other link
+ * namespaces only touch its atomics, never the drain thread's pthread state.
+ */
+typedef struct log_ring
+{
+    log_slot_t slots[LOG_RING_SLOTS];
+    atomic_size_t enqueue_pos;      /* Next slot producers claim */
+    size_t dequeue_pos;             /* Next slot the drain thread reads */
+    atomic_uint wake_seq;           /* Futex word bumped on every publish */
+    atomic_int sleeping;            /* Drain thread is parked on wake_seq */
+    atomic_int running;             /* Drain thread accepts lines */
+    atomic_int stop;                /* Drain thread should exit once empty */
+    atomic_uint_least64_t last_hash; /* Hash of the most recent line, to spot repeats */
+    atomic_uint_least64_t next_ns;  /* Rate limiter: theoretical arrival time of the next repeat */
+    atomic_ulong rate_limited;      /* Lines refused by the rate limit */
+    atomic_ulong dropped;           /* Lines refused because the ring was full */
+    unsigned long reported;         /* rate_limited + dropped already reported */
+    char name[64];                  /* Owner name for the ring's own notices */
+    pthread_t thread;
+} log_ring_t;
+
+/**
+ * Initialize the ring and start its drain thread
+ * @param ring  Pointer to ring structure
+ * @param name  Owner name used in the ring's own notices
+ * @return  NULL on success, error message on failure
+ */
+const char* log_ring_start(log_ring_t* ring, const char* name);
+
+/**
+ * Queue one line for stderr without blocking
+ * @param ring  Pointer to ring structure
+ * @param level  Level tag, e.g. "ERROR"
+ * @param name  Source name
+ * @param message  Message text
+ * @return  0 if queued, -1 if the ring is not running, 1 if the line was counted as dropped
+ */
+int log_ring_write(log_ring_t* ring, const char* level, const char* name, const char* message);
+
+/**
+ * Write everything still queued, report suppressed lines and join the drain thread.
+ * Later log_ring_write calls return -1.
+ * @param ring  Pointer to ring structure
+ */
+void log_ring_stop(log_ring_t* ring);
+
+#endif // LOG_RING_H
@@ -0,0 +1,87 @@
+#include "mem_budget.h"
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Terminator plus a rough allocator header per queued string
+#define MEM_BUDGET_ITEM_OVERHEAD 17
+
+static void futex_wait(atomic_uint* word, unsigned expected)
+{
+    syscall(SYS_futex, (unsigned*)word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static void futex_wake_all(atomic_uint* word)
+{
+    syscall(SYS_futex, (unsigned*)word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+int mem_budget_init(mem_budget_t* budget, size_t limit)
+{
+    if (!budget || limit == 0) return -1;
+
+    budget->limit = limit;
+    atomic_init(&budget->used, 0);
+    atomic_init(&budget->peak, 0);
+    atomic_init(&budget->wake_seq, 0);
+    atomic_init(&budget->waiting, 0);
+    atomic_init(&budget->ingest_waits, 0);
+    return 0;
+}
+
+void mem_budget_destroy(mem_budget_t* budget)
+{
+    (void)budget;
+}
+
+void mem_budget_charge(mem_budget_t* budget, size_t bytes)
+{
+    if (!budget) return;
+    size_t used = atomic_fetch_add(&budget->used, bytes) + bytes;
+    size_t peak = atomic_load_explicit(&budget->peak, memory_order_relaxed);
+    while (used > peak &&
+           !atomic_compare_exchange_weak_explicit(&budget->peak, &peak, used,
+                                                  memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+}
+
+void mem_budget_release(mem_budget_t* budget, size_t bytes)
+{
+    if (!budget) return;
+    atomic_fetch_sub(&budget->used, bytes);
+    if (atomic_load(&budget->waiting))
+    {
+        atomic_fetch_add(&budget->wake_seq, 1);
+        futex_wake_all(&budget->wake_seq);
+    }
+}
+
+void mem_budget_wait(mem_budget_t* budget, size_t bytes)
+{
+    if (!budget) return;
+
+    int counted = 0;
+    for (;;)
+    {
+        // Sample the sequence before checking so a release in between is not missed
+        atomic_store(&budget->waiting, 1);
+        unsigned seq = atomic_load(&budget->wake_seq);
+        size_t used = atomic_load(&budget->used);
+        if (used == 0 || used + bytes <= budget->limit) break;
+
+        if (!counted)
+        {
+            atomic_fetch_add_explicit(&budget->ingest_waits, 1, memory_order_relaxed);
+            counted = 1;
+        }
+        futex_wait(&budget->wake_seq, seq);
+    }
+    atomic_store(&budget->waiting, 0);
+}
+
+size_t mem_budget_item_size(size_t len)
+{
+    return len + MEM_BUDGET_ITEM_OVERHEAD;
+}
@@ -0,0 +1,69 @@
+#ifndef MEM_BUDGET_H
+#define MEM_BUDGET_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+/**
+ * Pipeline-wide byte budget shared by every stage queue.
+ * Queues charge on put and release on get; only ingest waits for room, so a
+ * stage can never deadlock against its own downstream. The structure is owned
+ * by the analyzer and handed to each plugin by pointer (plugin_set_budget).
+ * Plugins are loaded into separate link namespaces with their own libc, so the
+ * budget avoids pthread objects and uses atomics plus a raw futex instead.
+ */
+typedef struct mem_budget
+{
+    size_t limit;                   /* Configured ceiling in bytes */
+    atomic_size_t used;             /* Bytes currently held by queues */
+    atomic_size_t peak;             /* Highest value of used */
+    atomic_uint wake_seq;           /* Futex word bumped on release while ingest waits */
+    atomic_int waiting;             /* Non-zero while ingest is blocked */
+    atomic_ulong ingest_waits;      /* Times ingest had to wait for room */
+} mem_budget_t;
+
+/**
+ * Initialize a budget  
+ * @param budget  Pointer to budget structure  
+ * @param limit  Ceiling in bytes (must be > 0)  
+ * @return  0 on success, -1 on failure  
+ */
+int mem_budget_init(mem_budget_t* budget, size_t limit);
+
+/**
+ * Destroy a budget  
+ * @param budget  Pointer to budget structure  
+ */
+void mem_budget_destroy(mem_budget_t* budget);
+
+/**
+ * Account bytes held by a queue. Never blocks; may exceed the limit.  
+ * @param budget  Pointer to budget structure (NULL is a no-op)  
+ * @param bytes  Number of bytes  
+ */
+void mem_budget_charge(mem_budget_t* budget, size_t bytes);
+
+/**
+ * Return bytes to the budget and wake ingest if it is waiting  
+ * @param budget  Pointer to budget structure (NULL is a no-op)  
+ * @param bytes  Number of bytes  
+ */
+void mem_budget_release(mem_budget_t* budget, size_t bytes);
+
+/**
+ * Block until bytes more would fit under the limit (ingest backpressure).  
+ * An empty pipeline always admits, so a record larger than the limit  
+ * cannot wedge the pipeline.  
+ * @param budget  Pointer to budget structure (NULL is a no-op)  
+ * @param bytes  Number of bytes about to enter the pipeline  
+ */
+void mem_budget_wait(mem_budget_t* budget, size_t bytes);
+
+/**
+ * Bytes a queued string of the given length is charged  
+ * @param len  String length excluding the terminator  
+ * @return  Charged size including terminator and slot overhead  
+ */
+size_t mem_budget_item_size(size_t len);
+
+#endif // MEM_BUDGET_H
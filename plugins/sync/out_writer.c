@@ -0,0 +1,136 @@
+#include "out_writer.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define OUT_WRITER_RING_DEPTH 4
+
+// Blocking write of the whole range
+static void write_all(out_writer_t* writer, const char* data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(writer->fd, data, len);
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+            if (!writer->error) writer->error = errno;
+            return;
+        }
+        writer->writes++;
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static int submit_pending(out_writer_t* writer)
+{
+    if (uring_prep_write(&writer->ring, writer->fd, writer->pending, (unsigned)writer->pending_len, -1, 0) != 0 ||
+        uring_submit(&writer->ring) != 0)
+    {
+        return -1;
+    }
+    writer->writes++;
+    return 0;
+}
+
+// Reap completions until the in-flight buffer has been written completely
+static void wait_pending(out_writer_t* writer)
+{
+    while (writer->pending)
+    {
+        uint64_t tag;
+        int res;
+        int rc = uring_reap(&writer->ring, 1, &tag, &res);
+        if (rc < 0 || (rc == 1 && res < 0 && res != -EINTR && res != -EAGAIN))
+        {
+            // Finish synchronously; the ring has nothing else in flight
+            if (rc == 1 && !writer->error) writer->error = -res;
+            write_all(writer, writer->pending, writer->pending_len);
+            writer->pending = NULL;
+            return;
+        }
+        if (rc == 0) // nothing in flight: resubmission failed earlier
+        {
+            write_all(writer, writer->pending, writer->pending_len);
+            writer->pending = NULL;
+            return;
+        }
+        if (res > 0)
+        {
+            writer->pending += res;
+            writer->pending_len -= (size_t)res;
+        }
+        // Short write or retryable error: issue the rest. If that cannot be submitted
+        // the next reap finds nothing in flight and we finish synchronously.
+        if (writer->pending_len == 0) writer->pending = NULL;
+        else submit_pending(writer);
+    }
+}
+
+int out_writer_init(out_writer_t* writer, int fd, int use_uring)
+{
+    if (!writer) return -1;
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = fd;
+    writer->ring.fd = -1;
+
+    writer->bufs[0] = malloc(OUT_WRITER_BUFFER);
+    writer->bufs[1] = use_uring ? malloc(OUT_WRITER_BUFFER) : NULL;
+    if (!writer->bufs[0] || (use_uring && !writer->bufs[1]))
+    {
+        free(writer->bufs[0]);
+        free(writer->bufs[1]);
+        return -1;
+    }
+    writer->use_uring = use_uring && uring_init(&writer->ring, OUT_WRITER_RING_DEPTH) == 0;
+    return 0;
+}
+
+void out_writer_flush(out_writer_t* writer, int wait)
+{
+    if (!writer->use_uring)
+    {
+        write_all(writer, writer->bufs[0], writer->fill);
+        writer->fill = 0;
+        return;
+    }
+
+    if (writer->fill > 0)
+    {
+        // Keep a single write in flight so bytes land in order
+        wait_pending(writer);
+        writer->pending = writer->bufs[writer->cur];
+        writer->pending_len = writer->fill;
+        if (submit_pending(writer) != 0) wait_pending(writer);
+        writer->cur ^= 1;
+        writer->fill = 0;
+    }
+    if (wait) wait_pending(writer);
+}
+
+void out_writer_append(out_writer_t* writer, const char* data, size_t len)
+{
+    if (writer->fill + len > OUT_WRITER_BUFFER) out_writer_flush(writer, 0);
+    if (len > OUT_WRITER_BUFFER)
+    {
+        // Too big to buffer: write it straight through behind what is queued
+        out_writer_flush(writer, 1);
+        write_all(writer, data, len);
+        return;
+    }
+    memcpy(writer->bufs[writer->cur] + writer->fill, data, len);
+    writer->fill += len;
+}
+
+void out_writer_destroy(out_writer_t* writer)
+{
+    if (!writer || !writer->bufs[0]) return;
+    out_writer_flush(writer, 1);
+    uring_destroy(&writer->ring);
+    free(writer->bufs[0]);
+    free(writer->bufs[1]);
+    writer->bufs[0] = NULL;
+    writer->bufs[1] = NULL;
+}
@@ -0,0 +1,60 @@
+#ifndef OUT_WRITER_H
+#define OUT_WRITER_H
+
+#include <stddef.h>
+#include "uring.h"
+
+#define OUT_WRITER_BUFFER (64 * 1024)
+
+/**
+ * Batching output sink. Appends accumulate in a buffer that is written out
+ * when full or on flush. With io_uring two buffers alternate: one is filled
+ * while the other's write is in flight, and at most one write is in flight
+ * so output order is preserved. Without io_uring flushes use write(2).
+ * Not thread-safe.
+ */
+typedef struct
+{
+    int fd;                         /* Destination file descriptor */
+    int use_uring;                  /* io_uring in use (init may have fallen back) */
+    uring_t ring;
+    char* bufs[2];                  /* Fill buffer and in-flight buffer */
+    int cur;                        /* Index of the buffer being filled */
+    size_t fill;                    /* Bytes in the fill buffer */
+    const char* pending;            /* Unwritten part of the in-flight buffer, NULL if idle */
+    size_t pending_len;
+    unsigned long writes;           /* Write requests issued */
+    int error;                      /* First write error (errno), 0 if none */
+} out_writer_t;
+
+/**
+ * Initialize a writer  
+ * @param writer  Pointer to writer structure  
+ * @param fd  Destination file descriptor  
+ * @param use_uring  Non-zero to try io_uring; falls back to write(2) if unavailable  
+ * @return  0 on success, -1 on allocation failure  
+ */
+int out_writer_init(out_writer_t* writer, int fd, int use_uring);
+
+/**
+ * Append bytes, writing out the buffer when it fills  
+ * @param writer  Pointer to writer structure  
+ * @param data  Bytes to append  
+ * @param len  Number of bytes  
+ */
+void out_writer_append(out_writer_t* writer, const char* data, size_t len);
+
+/**
+ * Start writing buffered bytes  
+ * @param writer  Pointer to writer structure  
+ * @param wait  Non-zero to return only once everything has reached the fd  
+ */
+void out_writer_flush(out_writer_t* writer, int wait);
+
+/**
+ * Flush, wait and release resources  
+ * @param writer  Pointer to writer structure  
+ */
+void out_writer_destroy(out_writer_t* writer);
+
+#endif // OUT_WRITER_H
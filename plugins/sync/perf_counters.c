@@ -0,0 +1,185 @@
+#define _GNU_SOURCE
+#include "perf_counters.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#define PERF_SOFTWARE_MASK ((1u << PERF_CONTEXT_SWITCHES) | (1u << PERF_PAGE_FAULTS) | (1u << PERF_CPU_NS))
+
+static const struct
+{
+    uint32_t type;
+    uint64_t config;
+} g_events[PERF_NUM_COUNTERS] = {
+    [PERF_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    [PERF_INSTRUCTIONS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    [PERF_CACHE_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    [PERF_CONTEXT_SWITCHES] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+    [PERF_PAGE_FAULTS] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    [PERF_CPU_NS] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+};
+
+static int open_event(perf_counter_t counter)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = g_events[counter].type;
+    attr.config = g_events[counter].config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // Hardware counts stay in user space, which unprivileged users may measure. Context
+    // switches happen in the kernel, so software events must include it to count at all.
+    attr.exclude_kernel = g_events[counter].type == PERF_TYPE_HARDWARE;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+static void read_rusage(uint64_t* value)
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_THREAD, &ru) != 0) memset(&ru, 0, sizeof(ru));
+    value[PERF_CONTEXT_SWITCHES] = (uint64_t)(ru.ru_nvcsw + ru.ru_nivcsw);
+    value[PERF_PAGE_FAULTS] = (uint64_t)(ru.ru_minflt + ru.ru_majflt);
+    value[PERF_CPU_NS] = (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL +
+                         (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+const char* perf_counters_init(perf_counters_t* counters, int num_stages, int software_only)
+{
+    if (!counters || num_stages <= 0) return "Invalid parameters";
+    counters->stages = calloc(num_stages, sizeof(perf_stage_t));
+    if (!counters->stages) return "Memory allocation failed";
+    counters->num_stages = num_stages;
+    counters->software_only = software_only;
+    return NULL;
+}
+
+void perf_counters_destroy(perf_counters_t* counters)
+{
+    if (!counters) return;
+    free(counters->stages);
+    counters->stages = NULL;
+    counters->num_stages = 0;
+}
+
+void perf_thread_start(const perf_counters_t* counters, perf_thread_t* thread)
+{
+    int software_open = 1;
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+    {
+        int hardware = g_events[c].type == PERF_TYPE_HARDWARE;
+        thread->fd[c] = hardware && counters->software_only ? -1 : open_event((perf_counter_t)c);
+        if (!hardware && thread->fd[c] < 0) software_open = 0;
+    }
+
+    // Without perf_event_open (seccomp, perf_event_paranoid 3) the kernel still keeps per-thread rusage
+    thread->use_rusage = !software_open;
+    if (thread->use_rusage)
+    {
+        for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+        {
+            if (!(PERF_SOFTWARE_MASK & (1u << c)) || thread->fd[c] < 0) continue;
+            close(thread->fd[c]);
+            thread->fd[c] = -1;
+        }
+        read_rusage(thread->rusage_start);
+    }
+
+    // Events count from the moment they open; zero them so opening does not count against the stage
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+    {
+        if (thread->fd[c] >= 0) ioctl(thread->fd[c], PERF_EVENT_IOC_RESET, 0);
+    }
+}
+
+void perf_thread_stop(perf_counters_t* counters, int stage, perf_thread_t* thread, unsigned long lines)
+{
+    if (!counters || stage < 0 || stage >= counters->num_stages) return;
+    perf_stage_t* out = &counters->stages[stage];
+
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+    {
+        if (thread->fd[c] < 0) continue;
+        uint64_t data[3];   // value, time enabled, time running
+        if (read(thread->fd[c], data, sizeof(data)) == (ssize_t)sizeof(data) && data[2] > 0)
+        {
+            // Scale up when the PMU was shared between more events than it has counters
+            uint64_t value = data[2] < data[1] ? (uint64_t)((double)data[0] * data[1] / data[2]) : data[0];
+            out->value[c] += value;
+            out->available |= 1u << c;
+        }
+        close(thread->fd[c]);
+        thread->fd[c] = -1;
+    }
+
+    if (thread->use_rusage)
+    {
+        uint64_t now[PERF_NUM_COUNTERS];
+        read_rusage(now);
+        for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+        {
+            if (!(PERF_SOFTWARE_MASK & (1u << c))) continue;
+            out->value[c] += now[c] - thread->rusage_start[c];
+            out->available |= 1u << c;
+        }
+        out->from_rusage = 1;
+    }
+    out->lines += lines;
+    out->threads++;
+}
+
+static void format_ratio(char* buf, size_t size, const perf_stage_t* s, perf_counter_t num, double den, int precision)
+{
+    if (!(s->available & (1u << num)) || den <= 0) snprintf(buf, size, "-");
+    else snprintf(buf, size, "%.*f", precision, (double)s->value[num] / den);
+}
+
+void perf_counters_report(const perf_counters_t* counters, const char* const* names)
+{
+    if (!counters || !counters->stages) return;
+
+    int hardware = 0, rusage = 0;
+    for (int i = 0; i < counters->num_stages; i++)
+    {
+        if (counters->stages[i].available & (1u << PERF_CYCLES)) hardware = 1;
+        if (counters->stages[i].from_rusage) rusage = 1;
+    }
+
+    fprintf(stderr, "Perf counters per stage thread:\n");
+    fprintf(stderr, "  %-14s %12s %10s %8s %12s %6s %12s %8s %8s\n", "stage", "lines", "cpu ms", "ns/line",
+            "cycles/line", "IPC", "misses/line", "ctx-sw", "faults");
+    for (int i = 0; i < counters->num_stages; i++)
+    {
+        const perf_stage_t* s = &counters->stages[i];
+        if (s->threads == 0)
+        {
+            fprintf(stderr, "  %-14s (no stage thread)\n", names[i]);
+            continue;
+        }
+        char cpu[32], per_line[32], cycles[32], ipc[32], misses[32], switches[32], faults[32];
+        format_ratio(cpu, sizeof(cpu), s, PERF_CPU_NS, 1e6, 1);
+        format_ratio(per_line, sizeof(per_line), s, PERF_CPU_NS, (double)s->lines, 0);
+        format_ratio(cycles, sizeof(cycles), s, PERF_CYCLES, (double)s->lines, 1);
+        format_ratio(misses, sizeof(misses), s, PERF_CACHE_MISSES, (double)s->lines, 3);
+        format_ratio(switches, sizeof(switches), s, PERF_CONTEXT_SWITCHES, 1, 0);
+        format_ratio(faults, sizeof(faults), s, PERF_PAGE_FAULTS, 1, 0);
+        if ((s->available & (1u << PERF_INSTRUCTIONS)) && (s->available & (1u << PERF_CYCLES)) && s->value[PERF_CYCLES])
+        {
+            snprintf(ipc, sizeof(ipc), "%.2f", (double)s->value[PERF_INSTRUCTIONS] / (double)s->value[PERF_CYCLES]);
+        }
+        else snprintf(ipc, sizeof(ipc), "-");
+        fprintf(stderr, "  %-14s %12lu %10s %8s %12s %6s %12s %8s %8s\n", names[i], s->lines, cpu, per_line, cycles, ipc,
+                misses, switches, faults);
+    }
+    if (!hardware)
+    {
+        fprintf(stderr, "  hardware counters %s; software counters only\n",
+                counters->software_only ? "not requested" : "unavailable (perf_event_paranoid or no PMU)");
+    }
+    if (rusage) fprintf(stderr, "  perf_event_open unavailable; software counts from getrusage\n");
+}
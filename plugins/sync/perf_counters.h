@@ -0,0 +1,96 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+
+/**
+ * Counters measured for each stage thread
+ */
+typedef enum
+{
+    PERF_CYCLES = 0,        /* Hardware: CPU cycles in user space */
+    PERF_INSTRUCTIONS,      /* Hardware: instructions retired in user space */
+    PERF_CACHE_MISSES,      /* Hardware: last-level cache misses in user space */
+    PERF_CONTEXT_SWITCHES,  /* Software: voluntary and involuntary */
+    PERF_PAGE_FAULTS,       /* Software: minor and major */
+    PERF_CPU_NS,            /* Software: CPU time of the thread */
+    PERF_NUM_COUNTERS
+} perf_counter_t;
+
+/**
+ * Totals of one stage. Written by the stage's own thread when it exits and
+ * read by the analyzer after every stage thread has been joined.
+ */
+typedef struct
+{
+    uint64_t value[PERF_NUM_COUNTERS];
+    unsigned available;     /* Bit (1u << counter) for every counter measured */
+    unsigned long lines;    /* Whole records the thread processed */
+    int threads;            /* Threads that reported */
+    int from_rusage;        /* Software counts came from getrusage(RUSAGE_THREAD) */
+} perf_stage_t;
+
+/**
+ * Opt-in per-stage performance counters. Owned by the analyzer and handed to
+ * plugins by pointer (plugin_set_counters), like the trace. Hardware counters
+ * are opened per thread with perf_event_open; where they are restricted
+ * (perf_event_paranoid, virtual machines without a PMU) only the software
+ * counters are reported, from perf_event_open or else from getrusage.
+ */
+typedef struct perf_counters
+{
+    int software_only;      /* Do not try hardware counters */
+    int num_stages;
+    perf_stage_t* stages;   /* num_stages entries */
+} perf_counters_t;
+
+/**
+ * Counters opened by one thread
+ */
+typedef struct
+{
+    int fd[PERF_NUM_COUNTERS];      /* perf_event fds, -1 if not opened */
+    uint64_t rusage_start[PERF_NUM_COUNTERS];
+    int use_rusage;                 /* Software counts from getrusage */
+} perf_thread_t;
+
+/**
+ * Initialize empty totals
+ * @param counters  Pointer to counters structure
+ * @param num_stages  Number of stages
+ * @param software_only  Skip hardware counters
+ * @return  NULL on success, error message on failure
+ */
+const char* perf_counters_init(perf_counters_t* counters, int num_stages, int software_only);
+
+/**
+ * Free the totals
+ * @param counters  Pointer to counters structure
+ */
+void perf_counters_destroy(perf_counters_t* counters);
+
+/**
+ * Start counting for the calling thread
+ * @param counters  Pointer to counters structure
+ * @param thread  Receives the thread's counters
+ */
+void perf_thread_start(const perf_counters_t* counters, perf_thread_t* thread);
+
+/**
+ * Stop counting for the calling thread and add its counts to a stage
+ * @param counters  Pointer to counters structure
+ * @param stage  Stage index
+ * @param thread  Counters from perf_thread_start
+ * @param lines  Whole records the thread processed
+ */
+void perf_thread_stop(perf_counters_t* counters, int stage, perf_thread_t* thread, unsigned long lines);
+
+/**
+ * Print a table of every stage to stderr: lines, CPU time, cycles and cache
+ * misses per line, IPC, context switches and page faults
+ * @param counters  Pointer to counters structure
+ * @param names  Name of every stage
+ */
+void perf_counters_report(const perf_counters_t* counters, const char* const* names);
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,147 @@
+#include "result_cache.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RESULT_CACHE_MUL 0x9E3779B97F4A7C15ULL
+
+// Eight bytes per step; lines are short, so speed matters more than strength
+static uint64_t hash_bytes(const char* data, size_t len)
+{
+    uint64_t h = (uint64_t)len * RESULT_CACHE_MUL;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, data + i, 8);
+        h = (h ^ w) * RESULT_CACHE_MUL;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    if (i < len) memcpy(&tail, data + i, len - i);
+    h = (h ^ tail) * RESULT_CACHE_MUL;
+    h ^= h >> 32;
+    return h;
+}
+
+const char* result_cache_init(result_cache_t* cache, int capacity, size_t max_key)
+{
+    if (!cache || capacity <= 0) return "Invalid parameters";
+
+    // About two buckets per entry keeps chains short
+    unsigned buckets = 1;
+    while (buckets < (unsigned)capacity * 2 && buckets < (1u << 30)) buckets <<= 1;
+
+    cache->entries = calloc(capacity, sizeof(result_cache_entry_t));
+    cache->buckets = malloc(buckets * sizeof(int));
+    if (!cache->entries || !cache->buckets)
+    {
+        free(cache->entries);
+        free(cache->buckets);
+        return "Memory allocation failed";
+    }
+    for (unsigned i = 0; i < buckets; i++) cache->buckets[i] = -1;
+
+    cache->capacity = capacity;
+    cache->count = 0;
+    cache->bucket_mask = buckets - 1;
+    cache->hand = 0;
+    cache->max_key = max_key;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+    return NULL;
+}
+
+void result_cache_destroy(result_cache_t* cache)
+{
+    if (!cache || !cache->entries) return;
+    for (int i = 0; i < cache->count; i++) free(cache->entries[i].key);
+    free(cache->entries);
+    free(cache->buckets);
+    cache->entries = NULL;
+    cache->buckets = NULL;
+    cache->count = 0;
+}
+
+const result_cache_entry_t* result_cache_lookup(result_cache_t* cache, const char* data, size_t len)
+{
+    if (!cache || !cache->entries || len > cache->max_key) return NULL;
+
+    uint64_t hash = hash_bytes(data, len);
+    for (int i = cache->buckets[hash & cache->bucket_mask]; i >= 0; i = cache->entries[i].next)
+    {
+        result_cache_entry_t* e = &cache->entries[i];
+        if (e->hash == hash && e->key_len == len && memcmp(e->key, data, len) == 0)
+        {
+            e->referenced = 1;
+            cache->hits++;
+            return e;
+        }
+    }
+    cache->misses++;
+    return NULL;
+}
+
+// Unlink an entry from its bucket chain
+static void unlink_entry(result_cache_t* cache, int index)
+{
+    int* link = &cache->buckets[cache->entries[index].hash & cache->bucket_mask];
+    while (*link != index) link = &cache->entries[*link].next;
+    *link = cache->entries[index].next;
+}
+
+// Second-chance sweep: clear reference bits until an unreferenced entry comes up
+static int evict(result_cache_t* cache)
+{
+    for (;;)
+    {
+        int index = cache->hand;
+        cache->hand = (cache->hand + 1) % cache->capacity;
+        result_cache_entry_t* e = &cache->entries[index];
+        if (e->referenced)
+        {
+            e->referenced = 0;
+            continue;
+        }
+        unlink_entry(cache, index);
+        free(e->key);
+        e->key = NULL;
+        cache->evictions++;
+        return index;
+    }
+}
+
+void result_cache_store(result_cache_t* cache, const char* data, size_t len, result_cache_kind_t kind,
+                        const char* out, size_t out_len)
+{
+    if (!cache || !cache->entries || len > cache->max_key) return;
+    if (kind != RESULT_CACHE_OUTPUT) out_len = 0;
+
+    // The same input can miss twice within one batch; keep a single entry
+    uint64_t hash = hash_bytes(data, len);
+    for (int i = cache->buckets[hash & cache->bucket_mask]; i >= 0; i = cache->entries[i].next)
+    {
+        const result_cache_entry_t* e = &cache->entries[i];
+        if (e->hash == hash && e->key_len == len && memcmp(e->key, data, len) == 0) return;
+    }
+
+    char* block = malloc(len + out_len + 1);
+    if (!block) return;
+    memcpy(block, data, len);
+    if (out_len) memcpy(block + len, out, out_len);
+    block[len + out_len] = '\0';
+
+    int index = cache->count < cache->capacity ? cache->count++ : evict(cache);
+    result_cache_entry_t* e = &cache->entries[index];
+    e->hash = hash;
+    e->key = block;
+    e->key_len = len;
+    e->out = block + len;
+    e->out_len = out_len;
+    e->kind = kind;
+    e->referenced = 0;
+
+    int* head = &cache->buckets[e->hash & cache->bucket_mask];
+    e->next = *head;
+    *head = index;
+}
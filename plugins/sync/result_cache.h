@@ -0,0 +1,84 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * What a cached transform did with its input
+ */
+typedef enum
+{
+    RESULT_CACHE_OUTPUT = 0,    /* Produced out/out_len */
+    RESULT_CACHE_PASS,          /* Passed the input through unchanged */
+    RESULT_CACHE_DROP           /* Dropped the record */
+} result_cache_kind_t;
+
+typedef struct
+{
+    uint64_t hash;
+    char* key;                  /* Input bytes; the output follows in the same allocation */
+    size_t key_len;
+    char* out;                  /* NUL-terminated output (RESULT_CACHE_OUTPUT only) */
+    size_t out_len;
+    result_cache_kind_t kind;
+    int next;                   /* Next entry in the same bucket, -1 ends the chain */
+    unsigned char referenced;   /* CLOCK bit, set on every hit */
+} result_cache_entry_t;
+
+/**
+ * Bounded memo table from input bytes to a transform's result, with CLOCK
+ * eviction. Not thread-safe: a stage processes one record at a time.
+ */
+typedef struct
+{
+    result_cache_entry_t* entries;  /* capacity slots, the first count in use */
+    int* buckets;                   /* Chain heads, -1 when empty */
+    int capacity;
+    int count;
+    unsigned bucket_mask;
+    int hand;                       /* CLOCK hand over entries */
+    size_t max_key;                 /* Longer inputs are not cached */
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+} result_cache_t;
+
+/**
+ * Initialize an empty cache
+ * @param cache  Pointer to cache structure
+ * @param capacity  Maximum number of entries
+ * @param max_key  Longest input that is cached, in bytes
+ * @return  NULL on success, error message on failure
+ */
+const char* result_cache_init(result_cache_t* cache, int capacity, size_t max_key);
+
+/**
+ * Free all entries
+ * @param cache  Pointer to cache structure
+ */
+void result_cache_destroy(result_cache_t* cache);
+
+/**
+ * Find the cached result for an input and count a hit or miss
+ * @param cache  Pointer to cache structure
+ * @param data  Input bytes
+ * @param len  Number of bytes
+ * @return  Entry valid until the next store, or NULL (miss, or input too long)
+ */
+const result_cache_entry_t* result_cache_lookup(result_cache_t* cache, const char* data, size_t len);
+
+/**
+ * Remember a result, evicting an entry not hit since the hand last passed it.
+ * Does nothing if the input is already cached.
+ * @param cache  Pointer to cache structure
+ * @param data  Input bytes
+ * @param len  Number of bytes
+ * @param kind  What the transform did
+ * @param out  Output bytes (RESULT_CACHE_OUTPUT only)
+ * @param out_len  Number of output bytes
+ */
+void result_cache_store(result_cache_t* cache, const char* data, size_t len, result_cache_kind_t kind,
+                        const char* out, size_t out_len);
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,122 @@
+#include "spill.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define SPILL_INITIAL_SIZE (1u << 20)  /* 1 MiB, grows by doubling */
+#define SPILL_ALIGN 8u
+#define SPILL_HEADER (sizeof(size_t) + sizeof(unsigned))  /* length, flags */
+
+static size_t spill_record_size(size_t len)
+{
+    size_t total = SPILL_HEADER + len;
+    return (total + SPILL_ALIGN - 1) & ~(size_t)(SPILL_ALIGN - 1);
+}
+
+static const char* spill_map(spill_segment_t* spill, size_t size)
+{
+    if (spill->map)
+    {
+        munmap(spill->map, spill->map_size);
+        spill->map = NULL;
+        spill->map_size = 0;
+    }
+    if (ftruncate(spill->fd, (off_t)size) != 0) return "Failed to resize spill segment";
+
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, spill->fd, 0);
+    if (map == MAP_FAILED) return "Failed to map spill segment";
+
+    spill->map = map;
+    spill->map_size = size;
+    return NULL;
+}
+
+const char* spill_init(spill_segment_t* spill)
+{
+    if (!spill) return "Invalid parameters";
+
+    const char* dir = getenv("TMPDIR");
+    if (!dir || !*dir) dir = "/tmp";
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/analyzer-spill-XXXXXX", dir);
+    spill->fd = mkstemp(path);
+    if (spill->fd < 0) return "Failed to create spill segment";
+    // Nobody else needs the name; the file disappears when the fd is closed
+    unlink(path);
+
+    spill->map = NULL;
+    spill->map_size = 0;
+    spill->read_off = 0;
+    spill->write_off = 0;
+    spill->records = 0;
+
+    const char* err = spill_map(spill, SPILL_INITIAL_SIZE);
+    if (err)
+    {
+        close(spill->fd);
+        spill->fd = -1;
+        return err;
+    }
+    return NULL;
+}
+
+void spill_destroy(spill_segment_t* spill)
+{
+    if (!spill) return;
+    if (spill->map) munmap(spill->map, spill->map_size);
+    if (spill->fd >= 0) close(spill->fd);
+    spill->map = NULL;
+    spill->fd = -1;
+    spill->records = 0;
+}
+
+const char* spill_append(spill_segment_t* spill, const char* data, size_t len, unsigned flags)
+{
+    if (!spill || !data) return "Invalid parameters";
+    if (!spill->map) return "Spill segment unavailable";
+
+    size_t need = spill_record_size(len);
+    if (spill->write_off + need > spill->map_size)
+    {
+        size_t size = spill->map_size * 2;
+        while (spill->write_off + need > size) size *= 2;
+        const char* err = spill_map(spill, size);
+        if (err) return err;
+    }
+
+    memcpy(spill->map + spill->write_off, &len, sizeof(size_t));
+    memcpy(spill->map + spill->write_off + sizeof(size_t), &flags, sizeof(unsigned));
+    memcpy(spill->map + spill->write_off + SPILL_HEADER, data, len);
+    spill->write_off += need;
+    spill->records++;
+    return NULL;
+}
+
+char* spill_pop(spill_segment_t* spill, size_t* len, unsigned* flags)
+{
+    if (!spill || spill->records == 0) return NULL;
+
+    size_t n;
+    memcpy(&n, spill->map + spill->read_off, sizeof(size_t));
+    char* item = malloc(n + 1);
+    if (!item) return NULL;
+    if (flags) memcpy(flags, spill->map + spill->read_off + sizeof(size_t), sizeof(unsigned));
+    memcpy(item, spill->map + spill->read_off + SPILL_HEADER, n);
+    item[n] = '\0';
+    if (len) *len = n;
+
+    spill->read_off += spill_record_size(n);
+    spill->records--;
+
+    // Fully drained: rewind and hand the blocks back to the filesystem
+    if (spill->records == 0)
+    {
+        spill->read_off = 0;
+        spill->write_off = 0;
+        if (ftruncate(spill->fd, 0) == 0) spill_map(spill, SPILL_INITIAL_SIZE);
+    }
+    return item;
+}
@@ -0,0 +1,55 @@
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stddef.h>
+
+/**
+ * Append-only overflow segment backed by an unlinked temporary file.
+ * Each record keeps its bytes and item flags.
+ * Records are appended at write_off and consumed in FIFO order from read_off;
+ * once fully drained the file is truncated so disk and page cache are released.
+ * Not thread-safe: callers serialize access (the queue mutex does this).
+ */
+typedef struct
+{
+    int fd;                 /* Unlinked temporary file descriptor */
+    char* map;              /* Shared mapping of the segment file */
+    size_t map_size;        /* Current size of file and mapping */
+    size_t read_off;        /* Offset of the oldest unread record */
+    size_t write_off;       /* Offset where the next record is appended */
+    size_t records;         /* Number of records not yet read back */
+} spill_segment_t;
+
+/**
+ * Create the temporary segment file ($TMPDIR or /tmp) and map it
+ * @param spill Pointer to segment structure
+ * @return  NULL on success, error message on failure
+ */
+const char* spill_init(spill_segment_t* spill);
+
+/**
+ * Unmap and close the segment, discarding unread records
+ * @param spill Pointer to segment structure
+ */
+void spill_destroy(spill_segment_t* spill);
+
+/**
+ * Append a record to the end of the segment, growing the file if needed
+ * @param spill Pointer to segment structure
+ * @param data  Record bytes
+ * @param len   Number of bytes
+ * @param flags Item flags stored with the record
+ * @return  NULL on success, error message on failure
+ */
+const char* spill_append(spill_segment_t* spill, const char* data, size_t len, unsigned flags);
+
+/**
+ * Read back the oldest record as a freshly allocated NUL-terminated string
+ * @param spill Pointer to segment structure
+ * @param len   Optional output for the record length (excluding terminator)
+ * @param flags Optional output for the item flags stored with the record
+ * @return  Heap copy owned by the caller, or NULL if empty / allocation failed
+ */
+char* spill_pop(spill_segment_t* spill, size_t* len, unsigned* flags);
+
+#endif // SPILL_H
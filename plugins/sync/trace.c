@@ -0,0 +1,220 @@
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// Per link namespace: where this copy records and which stage it stands for
+static trace_t* g_trace = NULL;
+static int g_stage = -1;
+
+// Per thread: 0 = no buffer yet, 1 = tls_buffer valid, -1 = out of slots
+static __thread trace_buffer_t* tls_buffer = NULL;
+static __thread int tls_state = 0;
+
+static uint64_t trace_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void trace_init(trace_t* trace)
+{
+    if (!trace) return;
+    trace->origin_ns = trace_now();
+    atomic_init(&trace->num_buffers, 0);
+    atomic_init(&trace->lost_threads, 0);
+    for (int i = 0; i < TRACE_MAX_THREADS; i++)
+    {
+        trace->buffers[i].tid = 0;
+        trace->buffers[i].label[0] = '\0';
+        trace->buffers[i].events = NULL;
+        atomic_init(&trace->buffers[i].count, 0);
+        atomic_init(&trace->buffers[i].dropped, 0);
+    }
+}
+
+void trace_destroy(trace_t* trace)
+{
+    if (!trace) return;
+    int n = atomic_load(&trace->num_buffers);
+    if (n > TRACE_MAX_THREADS) n = TRACE_MAX_THREADS;
+    for (int i = 0; i < n; i++)
+    {
+        if (trace->buffers[i].events) munmap(trace->buffers[i].events, TRACE_BUFFER_EVENTS * sizeof(trace_event_t));
+        trace->buffers[i].events = NULL;
+    }
+}
+
+void trace_attach(trace_t* trace, int stage)
+{
+    g_trace = trace;
+    g_stage = stage;
+}
+
+// Claim a slot for the calling thread; pages are only touched as events arrive
+static trace_buffer_t* trace_thread_buffer(void)
+{
+    if (tls_state == 1) return tls_buffer;
+    if (tls_state < 0 || !g_trace) return NULL;
+
+    int slot = atomic_fetch_add(&g_trace->num_buffers, 1);
+    if (slot >= TRACE_MAX_THREADS)
+    {
+        atomic_fetch_add(&g_trace->lost_threads, 1);
+        tls_state = -1;
+        return NULL;
+    }
+    trace_buffer_t* buf = &g_trace->buffers[slot];
+    void* events = mmap(NULL, TRACE_BUFFER_EVENTS * sizeof(trace_event_t), PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (events == MAP_FAILED)
+    {
+        atomic_fetch_add(&g_trace->lost_threads, 1);
+        tls_state = -1;
+        return NULL;
+    }
+    buf->tid = (int)syscall(SYS_gettid);
+    buf->events = events;
+    tls_buffer = buf;
+    tls_state = 1;
+    return buf;
+}
+
+void trace_thread_label(const char* label)
+{
+    if (!label) return;
+    trace_buffer_t* buf = trace_thread_buffer();
+    if (!buf) return;
+    snprintf(buf->label, sizeof(buf->label), "%s", label);
+}
+
+uint64_t trace_begin(void)
+{
+    return g_trace ? trace_now() : 0;
+}
+
+void trace_end(trace_kind_t kind, uint64_t start)
+{
+    if (!start) return;
+    trace_buffer_t* buf = trace_thread_buffer();
+    if (!buf) return;
+
+    size_t n = atomic_load_explicit(&buf->count, memory_order_relaxed);
+    if (n >= TRACE_BUFFER_EVENTS)
+    {
+        atomic_fetch_add_explicit(&buf->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    trace_event_t* ev = &buf->events[n];
+    ev->start_ns = start;
+    ev->end_ns = trace_now();
+    ev->kind = (uint32_t)kind;
+    ev->stage = g_stage;
+    atomic_store_explicit(&buf->count, n + 1, memory_order_release);
+}
+
+size_t trace_event_count(trace_t* trace, unsigned long* dropped)
+{
+    size_t total = 0;
+    unsigned long lost = 0;
+    if (trace)
+    {
+        int n = atomic_load(&trace->num_buffers);
+        if (n > TRACE_MAX_THREADS) n = TRACE_MAX_THREADS;
+        for (int i = 0; i < n; i++)
+        {
+            total += atomic_load(&trace->buffers[i].count);
+            lost += atomic_load(&trace->buffers[i].dropped);
+        }
+    }
+    if (dropped) *dropped = lost;
+    return total;
+}
+
+static void write_json_string(FILE* f, const char* s)
+{
+    fputc('"', f);
+    for (; *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c < 0x20) fprintf(f, "\\u%04x", c);
+        else fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+static const char* stage_name(const char* const* stage_names, int num_stages, int stage)
+{
+    if (stage < 0) return "analyzer";
+    if (stage < num_stages && stage_names[stage]) return stage_names[stage];
+    return "unknown";
+}
+
+const char* trace_write_json(trace_t* trace, const char* path, const char* const* stage_names, int num_stages)
+{
+    if (!trace || !path) return "Invalid parameters";
+
+    FILE* f = fopen(path, "w");
+    if (!f) return "Failed to open trace file";
+
+    int n = atomic_load(&trace->num_buffers);
+    if (n > TRACE_MAX_THREADS) n = TRACE_MAX_THREADS;
+
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"analyzer\"}}");
+
+    // One name per thread; a thread seen by several namespaces keeps the first label
+    for (int i = 0; i < n; i++)
+    {
+        trace_buffer_t* buf = &trace->buffers[i];
+        if (!buf->events || !buf->label[0]) continue;
+        int seen = 0;
+        for (int j = 0; j < i && !seen; j++)
+        {
+            seen = trace->buffers[j].events && trace->buffers[j].label[0] && trace->buffers[j].tid == buf->tid;
+        }
+        if (seen) continue;
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", buf->tid);
+        write_json_string(f, buf->label);
+        fprintf(f, "}}");
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        trace_buffer_t* buf = &trace->buffers[i];
+        if (!buf->events) continue;
+        size_t count = atomic_load_explicit(&buf->count, memory_order_acquire);
+        for (size_t k = 0; k < count; k++)
+        {
+            const trace_event_t* ev = &buf->events[k];
+            const char* stage = stage_name(stage_names, num_stages, ev->stage);
+            // Timestamps are microseconds relative to trace start
+            double ts = (double)(ev->start_ns - trace->origin_ns) / 1000.0;
+            double dur = (double)(ev->end_ns - ev->start_ns) / 1000.0;
+            fprintf(f, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,", buf->tid, ts, dur);
+            if (ev->kind == TRACE_PROCESS)
+            {
+                fprintf(f, "\"cat\":\"process\",\"name\":");
+                write_json_string(f, stage);
+                fprintf(f, "}");
+            }
+            else
+            {
+                fprintf(f, "\"cat\":\"queue\",\"name\":\"%s\",\"args\":{\"queue\":",
+                        ev->kind == TRACE_PUT_WAIT ? "put blocked" : "get blocked");
+                write_json_string(f, stage);
+                fprintf(f, "}}");
+            }
+        }
+    }
+    fprintf(f, "\n]}\n");
+
+    int failed = ferror(f);
+    if (fclose(f) != 0 || failed) return "Failed to write trace file";
+    return NULL;
+}
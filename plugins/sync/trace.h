@@ -0,0 +1,115 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRACE_MAX_THREADS 256
+#define TRACE_BUFFER_EVENTS (1u << 20)  /* per thread, further events are dropped */
+#define TRACE_LABEL_SIZE 32
+
+/**
+ * Kinds of recorded intervals
+ */
+typedef enum
+{
+    TRACE_PROCESS = 0,  /* A stage's processing function ran */
+    TRACE_PUT_WAIT,     /* A producer blocked on a full stage queue */
+    TRACE_GET_WAIT      /* A consumer blocked on an empty stage queue */
+} trace_kind_t;
+
+typedef struct
+{
+    uint64_t start_ns;      /* CLOCK_MONOTONIC */
+    uint64_t end_ns;
+    uint32_t kind;          /* trace_kind_t */
+    int32_t stage;          /* Stage index whose code or queue the interval belongs to */
+} trace_event_t;
+
+/**
+ * Events of one thread within one link namespace. Only the owning thread
+ * writes; events are read once every thread has been joined.
+ */
+typedef struct
+{
+    int tid;                        /* Kernel thread id */
+    char label[TRACE_LABEL_SIZE];   /* Thread name for the timeline, may be empty */
+    trace_event_t* events;          /* mmap'ed array of TRACE_BUFFER_EVENTS */
+    atomic_size_t count;            /* Events recorded */
+    atomic_ulong dropped;           /* Events lost to a full buffer */
+} trace_buffer_t;
+
+/**
+ * Opt-in execution trace shared by the analyzer and every plugin.
+ * Like the memory budget it is owned by the analyzer and handed to plugins by
+ * pointer (plugin_set_trace). Each plugin has its own copy of this code and
+ * libc, so threads claim buffers with an atomic counter and buffers come from
+ * mmap, never from a particular libc's heap.
+ */
+typedef struct trace
+{
+    uint64_t origin_ns;                     /* CLOCK_MONOTONIC at trace_init */
+    atomic_int num_buffers;                 /* Buffer slots claimed so far */
+    atomic_ulong lost_threads;              /* Threads that found every slot taken */
+    trace_buffer_t buffers[TRACE_MAX_THREADS];
+} trace_t;
+
+/**
+ * Initialize an empty trace
+ * @param trace  Pointer to trace structure
+ */
+void trace_init(trace_t* trace);
+
+/**
+ * Release all thread buffers
+ * @param trace  Pointer to trace structure
+ */
+void trace_destroy(trace_t* trace);
+
+/**
+ * Make this link namespace record into trace (NULL disables recording)
+ * @param trace  Pointer to trace structure
+ * @param stage  Stage index attributed to events recorded here, -1 for the analyzer
+ */
+void trace_attach(trace_t* trace, int stage);
+
+/**
+ * Name the calling thread on the timeline
+ * @param label  Thread name (truncated to fit)
+ */
+void trace_thread_label(const char* label);
+
+/**
+ * Start an interval
+ * @return  Start timestamp, 0 when tracing is off
+ */
+uint64_t trace_begin(void);
+
+/**
+ * Record an interval that began at trace_begin()
+ * @param kind  Interval kind
+ * @param start  Value returned by trace_begin (0 is ignored)
+ */
+void trace_end(trace_kind_t kind, uint64_t start);
+
+/**
+ * Totals over all thread buffers
+ * @param trace  Pointer to trace structure
+ * @param dropped  Output for events lost to full buffers
+ * @return  Number of recorded events
+ */
+size_t trace_event_count(trace_t* trace, unsigned long* dropped);
+
+/**
+ * Write all recorded events as Chrome trace-event JSON (chrome://tracing, Perfetto).
+ * Call only after every traced thread has finished.
+ * @param trace  Pointer to trace structure
+ * @param path  Output file
+ * @param stage_names  Name of each stage index
+ * @param num_stages  Number of entries in stage_names
+ * @return  NULL on success, error message on failure
+ */
+const char* trace_write_json(trace_t* trace, const char* path, const char* const* stage_names, int num_stages);
+
+#endif // TRACE_H
@@ -0,0 +1,151 @@
+#include "uring.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+static int sys_uring_setup(unsigned entries, struct io_uring_params* params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+int uring_init(uring_t* ring, unsigned entries)
+{
+    if (!ring) return -1;
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = sys_uring_setup(entries, &params);
+    if (fd < 0) return -1; // ENOSYS on old kernels, EPERM under seccomp or sysctl
+
+    // The rings are mapped separately; kernels with IORING_FEAT_SINGLE_MMAP accept that too
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         fd, IORING_OFF_CQ_RING);
+    void* sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        if (ring->sq_ring != MAP_FAILED) munmap(ring->sq_ring, ring->sq_ring_size);
+        if (ring->cq_ring != MAP_FAILED) munmap(ring->cq_ring, ring->cq_ring_size);
+        if (sqes != MAP_FAILED) munmap(sqes, ring->sqes_size);
+        close(fd);
+        memset(ring, 0, sizeof(*ring));
+        ring->fd = -1;
+        return -1;
+    }
+
+    char* sq = ring->sq_ring;
+    char* cq = ring->cq_ring;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->sqes = sqes;
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    ring->entries = params.sq_entries;
+    ring->fd = fd;
+    return 0;
+}
+
+void uring_destroy(uring_t* ring)
+{
+    if (!ring || ring->fd < 0) return;
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+static int uring_prep(uring_t* ring, int op, int fd, const void* buf, unsigned len, off_t offset, uint64_t tag)
+{
+    if (!ring || ring->fd < 0) return -1;
+
+    unsigned tail = *ring->sq_tail;
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= ring->entries) return -1;
+
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (unsigned char)op;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->off = (uint64_t)(int64_t)offset; // -1 selects the current file position
+    sqe->user_data = tag;
+    ring->sq_array[index] = index;
+
+    // Publish the entry before the new tail
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+    return 0;
+}
+
+int uring_prep_read(uring_t* ring, int fd, void* buf, unsigned len, off_t offset, uint64_t tag)
+{
+    return uring_prep(ring, IORING_OP_READ, fd, buf, len, offset, tag);
+}
+
+int uring_prep_write(uring_t* ring, int fd, const void* buf, unsigned len, off_t offset, uint64_t tag)
+{
+    return uring_prep(ring, IORING_OP_WRITE, fd, buf, len, offset, tag);
+}
+
+int uring_submit(uring_t* ring)
+{
+    if (!ring || ring->fd < 0) return -EBADF;
+    while (ring->to_submit > 0)
+    {
+        int n = sys_uring_enter(ring->fd, ring->to_submit, 0, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+            return -errno;
+        }
+        ring->to_submit -= (unsigned)n;
+        ring->in_flight += (unsigned)n;
+    }
+    return 0;
+}
+
+int uring_reap(uring_t* ring, int wait, uint64_t* tag, int* res)
+{
+    if (!ring || ring->fd < 0) return -EBADF;
+
+    for (;;)
+    {
+        unsigned head = *ring->cq_head;
+        if (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+        {
+            struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+            if (tag) *tag = cqe->user_data;
+            if (res) *res = cqe->res;
+            // Hand the slot back only after reading it
+            __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+            ring->in_flight--;
+            return 1;
+        }
+        if (!wait || ring->in_flight == 0) return 0;
+
+        if (sys_uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) return -errno;
+    }
+}
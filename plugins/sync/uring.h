@@ -0,0 +1,94 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * Minimal io_uring instance driven through the raw syscalls (no liburing).
+ * Used single-threaded: one owner prepares, submits and reaps.
+ */
+typedef struct
+{
+    int fd;                         /* Ring file descriptor, -1 when unavailable */
+    unsigned entries;               /* Submission queue size */
+    unsigned in_flight;             /* Submitted requests not yet reaped */
+    unsigned to_submit;             /* Prepared SQEs not yet passed to the kernel */
+
+    void* sq_ring;                  /* Submission ring mapping */
+    size_t sq_ring_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;      /* Submission entries mapping */
+    size_t sqes_size;
+
+    void* cq_ring;                  /* Completion ring mapping */
+    size_t cq_ring_size;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+} uring_t;
+
+/**
+ * Set up a ring  
+ * @param ring  Pointer to ring structure  
+ * @param entries  Submission queue depth  
+ * @return  0 on success, -1 if io_uring is unavailable (ring->fd stays -1)  
+ */
+int uring_init(uring_t* ring, unsigned entries);
+
+/**
+ * Tear down a ring. Requests still in flight are abandoned.  
+ * @param ring  Pointer to ring structure  
+ */
+void uring_destroy(uring_t* ring);
+
+/**
+ * Queue a read. Not visible to the kernel before uring_submit.  
+ * @param ring  Pointer to ring structure  
+ * @param fd  File to read  
+ * @param buf  Destination buffer  
+ * @param len  Bytes to read  
+ * @param offset  File offset, or -1 for the current file position  
+ * @param tag  Returned with the completion  
+ * @return  0 on success, -1 if the submission queue is full  
+ */
+int uring_prep_read(uring_t* ring, int fd, void* buf, unsigned len, off_t offset, uint64_t tag);
+
+/**
+ * Queue a write. Not visible to the kernel before uring_submit.  
+ * @param ring  Pointer to ring structure  
+ * @param fd  File to write  
+ * @param buf  Source buffer, must stay valid until completion  
+ * @param len  Bytes to write  
+ * @param offset  File offset, or -1 for the current file position  
+ * @param tag  Returned with the completion  
+ * @return  0 on success, -1 if the submission queue is full  
+ */
+int uring_prep_write(uring_t* ring, int fd, const void* buf, unsigned len, off_t offset, uint64_t tag);
+
+/**
+ * Hand prepared requests to the kernel  
+ * @param ring  Pointer to ring structure  
+ * @return  0 on success, -errno on failure  
+ */
+int uring_submit(uring_t* ring);
+
+/**
+ * Take one completion  
+ * @param ring  Pointer to ring structure  
+ * @param wait  Non-zero to block until a completion arrives  
+ * @param tag  Output: tag passed when the request was prepared  
+ * @param res  Output: bytes transferred or -errno  
+ * @return  1 if a completion was taken, 0 if none (or nothing in flight), -errno on failure  
+ */
+int uring_reap(uring_t* ring, int wait, uint64_t* tag, int* res);
+
+#endif // URING_H
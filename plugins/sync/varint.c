@@ -0,0 +1,32 @@
+#include "varint.h"
+
+size_t varint_encode(uint64_t value, unsigned char* out)
+{
+    size_t n = 0;
+    while (value >= 0x80)
+    {
+        out[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (unsigned char)value;
+    return n;
+}
+
+int varint_decode(const unsigned char* data, size_t len, uint64_t* value, size_t* used)
+{
+    uint64_t result = 0;
+    for (size_t i = 0; i < len && i < VARINT_MAX_BYTES; i++)
+    {
+        uint64_t group = data[i] & 0x7f;
+        // The tenth byte may only carry the top bit of a 64-bit value
+        if (i == VARINT_MAX_BYTES - 1 && group > 1) return -1;
+        result |= group << (7 * i);
+        if (!(data[i] & 0x80))
+        {
+            *value = result;
+            *used = i + 1;
+            return 1;
+        }
+    }
+    return len >= VARINT_MAX_BYTES ? -1 : 0;
+}
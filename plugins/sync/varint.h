@@ -0,0 +1,29 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Longest encoding of a 64-bit value */
+#define VARINT_MAX_BYTES 10
+
+/**
+ * Encode an unsigned LEB128 varint (7 bits per byte, low group first,
+ * high bit set on every byte but the last)  
+ * @param value  Value to encode  
+ * @param out  Destination with room for VARINT_MAX_BYTES  
+ * @return  Number of bytes written  
+ */
+size_t varint_encode(uint64_t value, unsigned char* out);
+
+/**
+ * Decode an unsigned LEB128 varint  
+ * @param data  Encoded bytes  
+ * @param len  Bytes available  
+ * @param value  Output: decoded value  
+ * @param used  Output: bytes consumed  
+ * @return  1 on success, 0 if more bytes are needed, -1 if malformed  
+ */
+int varint_decode(const unsigned char* data, size_t len, uint64_t* value, size_t* used);
+
+#endif // VARINT_H
@@ -0,0 +1,321 @@
+#include "plugin_common.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TOPK_DEPTH 4                // sketch rows; the estimate is the minimum over them
+#define TOPK_DEFAULT_WIDTH 65536    // counters per row (1 MiB of sketch in total)
+#define TOPK_DEFAULT_K 10
+#define TOPK_MAX_K 10000
+#define TOPK_MAX_KEY 256            // longer keys are shown truncated
+#define TOPK_MUL 0x9E3779B97F4A7C15ULL
+
+typedef struct
+{
+    uint64_t hash;
+    uint32_t count;             // sketch estimate when last seen
+    uint32_t slot;              // position in the index table
+    size_t len;                 // full key length
+    char key[TOPK_MAX_KEY];     // first TOPK_MAX_KEY bytes of the key
+} topk_entry_t;
+
+// Count-min sketch plus a min-heap of the K keys with the highest estimates.
+// All memory is allocated at init.
+typedef struct
+{
+    uint32_t* sketch;           // TOPK_DEPTH rows of width counters
+    uint32_t width_mask;
+    topk_entry_t* heap;         // min-heap on count, size entries in use
+    int size;
+    int k;
+    int* index;                 // open addressing on hash: heap position + 1, 0 when empty
+    uint32_t index_mask;
+    int words;                  // count whitespace-separated words instead of lines
+    unsigned long every;        // report every N lines, 0 for the end only
+    unsigned long lines;
+    unsigned long tokens;
+    unsigned long reported;     // lines covered by the last report
+} topk_t;
+
+static topk_t g_topk;
+
+static uint64_t hash_key(const char* data, size_t len)
+{
+    uint64_t h = (uint64_t)len * TOPK_MUL;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, data + i, 8);
+        h = (h ^ w) * TOPK_MUL;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    if (i < len) memcpy(&tail, data + i, len - i);
+    h = (h ^ tail) * TOPK_MUL;
+    h ^= h >> 32;
+    return h;
+}
+
+// Conservative update: raise only the counters at the current minimum, which
+// keeps the overestimate from colliding keys lower than a plain increment
+static uint32_t sketch_add(topk_t* t, uint64_t hash)
+{
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1u;
+    uint32_t* cells[TOPK_DEPTH];
+    uint32_t min = UINT32_MAX;
+    for (int d = 0; d < TOPK_DEPTH; d++)
+    {
+        cells[d] = &t->sketch[(size_t)d * (t->width_mask + 1) + ((h1 + (uint32_t)d * h2) & t->width_mask)];
+        if (*cells[d] < min) min = *cells[d];
+    }
+    if (min == UINT32_MAX) return min;
+    min++;
+    for (int d = 0; d < TOPK_DEPTH; d++)
+    {
+        if (*cells[d] < min) *cells[d] = min;
+    }
+    return min;
+}
+
+static int entry_is(const topk_entry_t* e, uint64_t hash, const char* key, size_t len)
+{
+    size_t stored = len < TOPK_MAX_KEY ? len : TOPK_MAX_KEY;
+    return e->hash == hash && e->len == len && memcmp(e->key, key, stored) == 0;
+}
+
+static int index_find(const topk_t* t, uint64_t hash, const char* key, size_t len)
+{
+    for (uint32_t s = (uint32_t)hash & t->index_mask; t->index[s]; s = (s + 1) & t->index_mask)
+    {
+        int pos = t->index[s] - 1;
+        if (entry_is(&t->heap[pos], hash, key, len)) return pos;
+    }
+    return -1;
+}
+
+static void index_insert(topk_t* t, int pos)
+{
+    uint32_t s = (uint32_t)t->heap[pos].hash & t->index_mask;
+    while (t->index[s]) s = (s + 1) & t->index_mask;
+    t->index[s] = pos + 1;
+    t->heap[pos].slot = s;
+}
+
+// Backward-shift deletion keeps probe chains intact without tombstones
+static void index_remove(topk_t* t, uint32_t slot)
+{
+    uint32_t hole = slot;
+    for (uint32_t s = (slot + 1) & t->index_mask; t->index[s]; s = (s + 1) & t->index_mask)
+    {
+        uint32_t home = (uint32_t)t->heap[t->index[s] - 1].hash & t->index_mask;
+        // Move the entry back if its home is not in (hole, s]
+        if (((s - home) & t->index_mask) >= ((s - hole) & t->index_mask))
+        {
+            t->index[hole] = t->index[s];
+            t->heap[t->index[hole] - 1].slot = hole;
+            hole = s;
+        }
+    }
+    t->index[hole] = 0;
+}
+
+static void heap_swap(topk_t* t, int a, int b)
+{
+    topk_entry_t tmp = t->heap[a];
+    t->heap[a] = t->heap[b];
+    t->heap[b] = tmp;
+    t->index[t->heap[a].slot] = a + 1;
+    t->index[t->heap[b].slot] = b + 1;
+}
+
+static void sift_down(topk_t* t, int pos)
+{
+    for (;;)
+    {
+        int smallest = pos;
+        int l = 2 * pos + 1, r = l + 1;
+        if (l < t->size && t->heap[l].count < t->heap[smallest].count) smallest = l;
+        if (r < t->size && t->heap[r].count < t->heap[smallest].count) smallest = r;
+        if (smallest == pos) return;
+        heap_swap(t, pos, smallest);
+        pos = smallest;
+    }
+}
+
+static void sift_up(topk_t* t, int pos)
+{
+    while (pos > 0 && t->heap[(pos - 1) / 2].count > t->heap[pos].count)
+    {
+        heap_swap(t, pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+}
+
+static void fill_entry(topk_entry_t* e, uint64_t hash, const char* key, size_t len, uint32_t count)
+{
+    e->hash = hash;
+    e->count = count;
+    e->len = len;
+    memcpy(e->key, key, len < TOPK_MAX_KEY ? len : TOPK_MAX_KEY);
+}
+
+static void topk_add(topk_t* t, const char* key, size_t len)
+{
+    uint64_t hash = hash_key(key, len);
+    uint32_t count = sketch_add(t, hash);
+    t->tokens++;
+
+    int pos = index_find(t, hash, key, len);
+    if (pos >= 0)
+    {
+        // Estimates only grow, so a tracked key can only move away from the root
+        t->heap[pos].count = count;
+        sift_down(t, pos);
+    }
+    else if (t->size < t->k)
+    {
+        pos = t->size++;
+        fill_entry(&t->heap[pos], hash, key, len, count);
+        index_insert(t, pos);
+        sift_up(t, pos);
+    }
+    else if (count > t->heap[0].count)
+    {
+        index_remove(t, t->heap[0].slot);
+        fill_entry(&t->heap[0], hash, key, len, count);
+        index_insert(t, 0);
+        sift_down(t, 0);
+    }
+}
+
+static int by_count_desc(const void* a, const void* b)
+{
+    const topk_entry_t* x = *(const topk_entry_t* const*)a;
+    const topk_entry_t* y = *(const topk_entry_t* const*)b;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    size_t n = x->len < y->len ? x->len : y->len;
+    if (n > TOPK_MAX_KEY) n = TOPK_MAX_KEY;
+    int c = memcmp(x->key, y->key, n);
+    return c ? c : (x->len > y->len) - (x->len < y->len);
+}
+
+// Emit a header line and one "count key" line per tracked key, highest first
+static void topk_report(topk_t* t)
+{
+    char line[TOPK_MAX_KEY + 64];
+    int n = t->words ? snprintf(line, sizeof(line), "top %d of %lu words in %lu lines", t->size, t->tokens, t->lines)
+                     : snprintf(line, sizeof(line), "top %d of %lu lines", t->size, t->lines);
+    common_plugin_emit(line, (size_t)n);
+
+    const topk_entry_t* order[TOPK_MAX_K];
+    for (int i = 0; i < t->size; i++) order[i] = &t->heap[i];
+    qsort(order, (size_t)t->size, sizeof(order[0]), by_count_desc);
+    for (int i = 0; i < t->size; i++)
+    {
+        const topk_entry_t* e = order[i];
+        int shown = (int)(e->len < TOPK_MAX_KEY ? e->len : TOPK_MAX_KEY);
+        n = snprintf(line, sizeof(line), "%7u %.*s%s", e->count, shown, e->key,
+                     e->len > TOPK_MAX_KEY ? "..." : "");
+        common_plugin_emit(line, (size_t)n);
+    }
+    t->reported = t->lines;
+}
+
+// Plugin-specific processing function: consumes every record
+static const char* topk_process(const char* str, size_t len, size_t* out_len)
+{
+    (void)out_len;
+    if (!str) return NULL;
+
+    topk_t* t = &g_topk;
+    if (!t->words)
+    {
+        topk_add(t, str, len);
+    }
+    else
+    {
+        size_t i = 0;
+        while (i < len)
+        {
+            while (i < len && (str[i] == ' ' || str[i] == '\t')) i++;
+            size_t start = i;
+            while (i < len && str[i] != ' ' && str[i] != '\t') i++;
+            if (i > start) topk_add(t, str + start, i - start);
+        }
+    }
+
+    t->lines++;
+    if (t->every && t->lines % t->every == 0) topk_report(t);
+    return NULL;
+}
+
+static void topk_free(topk_t* t)
+{
+    free(t->sketch);
+    free(t->heap);
+    free(t->index);
+    memset(t, 0, sizeof(*t));
+}
+
+static void topk_flush(int final)
+{
+    if (!final) return;
+    // Skip a report identical to the periodic one just emitted
+    if (g_topk.lines == 0 || g_topk.lines != g_topk.reported) topk_report(&g_topk);
+    topk_free(&g_topk);
+}
+
+// Parse a positive integer option, or keep the default when unset
+static const char* option_count(const char* key, long max, long* value)
+{
+    const char* text = common_plugin_option(key);
+    if (!text) return NULL;
+    char* end;
+    long v = strtol(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || v <= 0 || v > max) return "Invalid topk option value";
+    *value = v;
+    return NULL;
+}
+
+// Plugin initialization (new API)
+const char* plugin_init(int queue_size)
+{
+    long k = TOPK_DEFAULT_K, every = 0, width = TOPK_DEFAULT_WIDTH;
+    const char* err = option_count("k", TOPK_MAX_K, &k);
+    if (!err) err = option_count("every", LONG_MAX, &every);
+    if (!err) err = option_count("width", 1L << 24, &width);
+    if (err) return err;
+
+    const char* token = common_plugin_option("token");
+    if (token && strcmp(token, "line") != 0 && strcmp(token, "word") != 0) return "Expected token=line or token=word";
+
+    topk_t* t = &g_topk;
+    memset(t, 0, sizeof(*t));
+    uint32_t w = 1;
+    while (w < (uint32_t)width) w <<= 1;
+    uint32_t slots = 1;
+    while (slots < (uint32_t)k * 2) slots <<= 1;
+
+    t->sketch = calloc((size_t)w * TOPK_DEPTH, sizeof(uint32_t));
+    t->heap = calloc((size_t)k, sizeof(topk_entry_t));
+    t->index = calloc(slots, sizeof(int));
+    if (!t->sketch || !t->heap || !t->index)
+    {
+        topk_free(t);
+        return "Memory allocation failed";
+    }
+    t->width_mask = w - 1;
+    t->index_mask = slots - 1;
+    t->k = (int)k;
+    t->every = (unsigned long)every;
+    t->words = token && strcmp(token, "word") == 0;
+
+    common_plugin_set_flush(topk_flush);
+    err = common_plugin_init_len(topk_process, "topk", queue_size);
+    if (err) topk_free(t);
+    return err;
+}
@@ -5,25 +5,31 @@
 
 
 // Plugin-specific processing function
-static const char* typewriter_process(const char* str) 
+static const char* typewriter_process(const char* str, size_t len, unsigned chunk, size_t* out_len) 
 {
     if (!str) return NULL;
 
-    fputs("[typewriter] ", stdout);
-    for (const char* p = str; *p != '\0'; p++) 
+    if (chunk & PLUGIN_CHUNK_BEGIN) fputs("[typewriter] ", stdout);
+    for (size_t i = 0; i < len; i++) 
     {
-        putchar(*p);
+        putchar(str[i]);
         fflush(stdout);
         usleep(100000); // 100ms delay per character
     }
 
-    putchar('\n');
-    fflush(stdout);
-    return strdup(str);
+    if (chunk & PLUGIN_CHUNK_END)
+    {
+        putchar('\n');
+        fflush(stdout);
+    }
+
+    // Pass the original record through unchanged
+    *out_len = len;
+    return str;
 }
 
 // Plugin initialization (new API)
 const char* plugin_init(int queue_size) 
 {
-    return common_plugin_init(typewriter_process, "typewriter", queue_size);
+    return common_plugin_init_stream(typewriter_process, "typewriter", queue_size);
 }
\ No newline at end of file
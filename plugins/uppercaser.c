@@ -1,24 +1,65 @@
 #include "plugin_common.h"
 #include <string.h>
+#include <stdlib.h>
 #include <ctype.h>
+#include <stdint.h>
 
 
 // Plugin-specific processing function
-static const char* uppercaser_process(const char* str) 
+// Works byte by byte, so chunks of a large record need no context
+static const char* uppercaser_process(const char* str, size_t len, unsigned chunk, size_t* out_len) 
 {
+    (void)chunk;
     if (!str) return NULL;
 
-    char* result = strdup(str);
+    char* result = malloc(len + 1);
     if (!result) return NULL;
-    for (int i = 0; result[i] != '\0'; i++) 
+    for (size_t i = 0; i < len; i++) 
     {
-        result[i] = toupper(result[i]);
+        result[i] = toupper((unsigned char)str[i]);
     }
+    result[len] = '\0';
+    *out_len = len;
     return result;
 }
 
+// Uppercase eight ASCII bytes at once: flag bytes in 'a'..'z' by their high bit
+// (bytes >= 0x80 never match) and clear 0x20 in exactly those bytes
+static uint64_t upper_word(uint64_t w)
+{
+    const uint64_t ones = 0x0101010101010101ULL;
+    uint64_t low7 = w & (0x7f * ones);
+    uint64_t ge_a = low7 + (0x80 - 'a') * ones;
+    uint64_t gt_z = low7 + (0x80 - 'z' - 1) * ones;
+    uint64_t mask = ge_a & ~gt_z & ~w & (0x80 * ones);
+    return w ^ (mask >> 2);
+}
+
+// Batch path for whole records: no call and no allocation per record
+static void uppercaser_batch(plugin_record_t* records, size_t count)
+{
+    for (size_t r = 0; r < count; r++)
+    {
+        const char* in = records[r].data;
+        char* out = records[r].out;
+        size_t len = records[r].len;
+        size_t i = 0;
+        for (; i + 8 <= len; i += 8)
+        {
+            uint64_t w;
+            memcpy(&w, in + i, 8);
+            w = upper_word(w);
+            memcpy(out + i, &w, 8);
+        }
+        for (; i < len; i++) out[i] = toupper((unsigned char)in[i]);
+        records[r].out_len = len;
+    }
+}
+
 // Plugin initialization (new API)
 const char* plugin_init(int queue_size) 
 {
-    return common_plugin_init(uppercaser_process, "uppercaser", queue_size);
+    common_plugin_set_deterministic();
+    common_plugin_set_batch(uppercaser_batch);
+    return common_plugin_init_stream(uppercaser_process, "uppercaser", queue_size);
 }
\ No newline at end of file
@@ -0,0 +1,710 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+// Open-loop load generator for the analyzer: sends lines at a fixed rate no matter how
+// fast the pipeline drains them, and measures each line's latency from the time it was
+// due to be sent, so time spent blocked behind a full queue is not hidden.
+
+#define LOADGEN_LINE_MAX 1023           // longest line the analyzer's line framing accepts
+#define LOADGEN_BATCH (64 * 1024)       // most bytes sent per write
+#define LOADGEN_MAX_LINES 50000000UL    // rate * (warmup + duration) limit, 8 bytes each
+#define LOADGEN_CONNECT_MS 5000         // how long to wait for --listen to come up
+#define LOADGEN_DRAIN_MS 5000           // socket mode: wait this long for missing output
+#define LOADGEN_BISECT 4                // sweep refinement steps after the first failure
+#define SENTINEL_END "<END>"
+
+// Log-linear histogram: 64 sub-buckets per power of two, under 1.6% error
+#define HIST_SUB_BITS 6
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (HIST_SUB + (64 - HIST_SUB_BITS) * HIST_SUB)
+
+typedef struct
+{
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} histogram_t;
+
+typedef struct
+{
+    // Options
+    unsigned long rate;         // lines per second
+    double duration;            // measured seconds
+    double warmup;              // seconds sent first and not measured
+    const char* connect;        // unix:PATH or tcp:PORT, NULL for the analyzer's stdin
+    const char* prefix;         // output lines that count as a delivered record
+    double slo_ms;              // sweep: a rate is sustainable while p99 stays within this
+    unsigned long max_rate;     // sweep: stop doubling here
+    int sweep;
+    char** analyzer_argv;
+
+    // Lines to replay, cycled
+    char** lines;
+    size_t* lens;
+    size_t num_lines;
+} loadgen_t;
+
+typedef struct
+{
+    const loadgen_t* lg;
+    unsigned long rate;
+    unsigned long total;        // lines to send, warmup included
+    unsigned long warmup_lines;
+    uint64_t t0;                // intended send time of line 0
+    uint64_t* sent_at;          // time each line's write was started
+    int in_fd;                  // analyzer stdin or socket
+    int out_fd;                 // analyzer stdout
+    pid_t pid;
+    unsigned long received;
+    unsigned long sent;
+    atomic_int send_done;       // sent and send_end are final
+    uint64_t send_end;
+    const char* send_error;
+    histogram_t corrected;      // from intended send time
+    histogram_t uncorrected;    // from actual send time
+} run_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t t)
+{
+    struct timespec ts = { (time_t)(t / 1000000000ULL), (long)(t % 1000000000ULL) };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+}
+
+static uint64_t intended_at(const run_t* run, unsigned long i)
+{
+    return run->t0 + (uint64_t)((double)i * 1e9 / (double)run->rate);
+}
+
+static int hist_index(uint64_t v)
+{
+    if (v < HIST_SUB) return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    return HIST_SUB + (e - HIST_SUB_BITS) * HIST_SUB + (int)((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+// Midpoint of a bucket's value range
+static uint64_t hist_value(int idx)
+{
+    if (idx < HIST_SUB) return (uint64_t)idx;
+    int e = (idx - HIST_SUB) / HIST_SUB + HIST_SUB_BITS;
+    uint64_t m = (uint64_t)((idx - HIST_SUB) % HIST_SUB);
+    uint64_t width = 1ULL << (e - HIST_SUB_BITS);
+    return (HIST_SUB + m) * width + width / 2;
+}
+
+static void hist_record(histogram_t* h, uint64_t v)
+{
+    h->counts[hist_index(v)]++;
+    h->total++;
+    if (v > h->max) h->max = v;
+}
+
+static uint64_t hist_percentile(const histogram_t* h, double p)
+{
+    if (h->total == 0) return 0;
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)h->total + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++)
+    {
+        seen += h->counts[i];
+        if (seen >= rank) return hist_value(i) < h->max ? hist_value(i) : h->max;
+    }
+    return h->max;
+}
+
+static void format_ns(uint64_t ns, char* buf, size_t size)
+{
+    if (ns < 1000) snprintf(buf, size, "%lu ns", (unsigned long)ns);
+    else if (ns < 1000000) snprintf(buf, size, "%.1f us", ns / 1e3);
+    else if (ns < 1000000000) snprintf(buf, size, "%.2f ms", ns / 1e6);
+    else snprintf(buf, size, "%.2f s", ns / 1e9);
+}
+
+static void print_histogram(const char* label, const histogram_t* h)
+{
+    static const double points[] = { 50, 90, 99, 99.9, 99.99 };
+    printf("  %-22s", label);
+    for (size_t i = 0; i < sizeof(points) / sizeof(points[0]); i++)
+    {
+        char value[32];
+        format_ns(hist_percentile(h, points[i]), value, sizeof(value));
+        printf(" p%-5g %-10s", points[i], value);
+    }
+    char max[32];
+    format_ns(h->max, max, sizeof(max));
+    printf(" max %s\n", max);
+}
+
+static void print_usage(void)
+{
+    printf("Usage: ./output/loadgen [options] -- ./output/analyzer [analyzer options] <queue_size> <plugins...>\n\n");
+    printf("Sends lines to the analyzer at a fixed rate, open loop, and reports their latency\n");
+    printf("from the time each line was due to be sent to the time it appears on the analyzer's\n");
+    printf("stdout. The pipeline must print every record once, in order (end it with logger).\n\n");
+    printf("Options:\n");
+    printf("  --rate N          Lines per second (default 10000); the first rate with --sweep\n");
+    printf("  --duration S      Seconds measured (default 5)\n");
+    printf("  --warmup S        Seconds sent first and not measured (default 1)\n");
+    printf("  --input FILE      Replay the lines of FILE, cycled (default: synthetic lines)\n");
+    printf("  --line-size N     Length of synthetic lines (default 64, at most %d)\n", LOADGEN_LINE_MAX);
+    printf("  --connect ADDR    Send through a socket instead of the analyzer's stdin:\n");
+    printf("                    unix:PATH or tcp:PORT, matching the analyzer's --listen\n");
+    printf("  --prefix TEXT     Output lines that count as delivered (default '[logger] ')\n");
+    printf("  --sweep           Double the rate until p99 exceeds --slo, then bisect, and report\n");
+    printf("                    the highest sustainable rate\n");
+    printf("  --slo MS          p99 latency a sustainable rate must meet (default 10)\n");
+    printf("  --max-rate N      Highest rate tried by --sweep (default 10000000)\n\n");
+    printf("Example:\n");
+    printf("  ./output/loadgen --rate 50000 -- ./output/analyzer 64 uppercaser logger\n");
+    printf("  ./output/loadgen --sweep --slo 5 -- ./output/analyzer --scheduler pool 64 uppercaser flipper logger\n");
+    printf("  ./output/loadgen --connect unix:/tmp/a.sock -- ./output/analyzer --listen unix:/tmp/a.sock 64 logger\n");
+}
+
+static int parse_count(const char* value, unsigned long* out)
+{
+    char* end;
+    errno = 0;
+    unsigned long long v = strtoull(value, &end, 10);
+    if (errno == ERANGE || end == value || *end != '\0' || v < 1 || v > ULONG_MAX) return -1;
+    *out = (unsigned long)v;
+    return 0;
+}
+
+static int parse_seconds(const char* value, double* out, double min)
+{
+    char* end;
+    errno = 0;
+    double v = strtod(value, &end);
+    if (errno == ERANGE || end == value || *end != '\0' || !(v >= min) || v > 86400) return -1;
+    *out = v;
+    return 0;
+}
+
+static const char* load_input(loadgen_t* lg, const char* path)
+{
+    FILE* f = fopen(path, "r");
+    if (!f) return strerror(errno);
+    char* line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    const char* error = NULL;
+    while ((n = getline(&line, &cap, f)) >= 0)
+    {
+        if (n > 0 && line[n - 1] == '\n') line[--n] = '\0';
+        if (strcmp(line, SENTINEL_END) == 0) continue;
+        if (n > LOADGEN_LINE_MAX)
+        {
+            error = "Input line longer than the analyzer accepts";
+            break;
+        }
+        char** lines = realloc(lg->lines, (lg->num_lines + 1) * sizeof(*lines));
+        size_t* lens = lines ? realloc(lg->lens, (lg->num_lines + 1) * sizeof(*lens)) : NULL;
+        if (lines) lg->lines = lines;
+        if (lens) lg->lens = lens;
+        char* copy = lens ? strdup(line) : NULL;
+        if (!copy)
+        {
+            error = "Memory allocation failed";
+            break;
+        }
+        lg->lines[lg->num_lines] = copy;
+        lg->lens[lg->num_lines] = (size_t)n;
+        lg->num_lines++;
+    }
+    free(line);
+    fclose(f);
+    if (!error && lg->num_lines == 0) error = "No lines in input";
+    return error;
+}
+
+// Synthetic lines differ in their first bytes so caches and filters see varied input
+static const char* make_lines(loadgen_t* lg, unsigned long size)
+{
+    static const char fill[] = "the quick brown fox jumps over the lazy dog ";
+    enum { SYNTHETIC_LINES = 1024 };
+    lg->lines = calloc(SYNTHETIC_LINES, sizeof(char*));
+    lg->lens = calloc(SYNTHETIC_LINES, sizeof(size_t));
+    if (!lg->lines || !lg->lens) return "Memory allocation failed";
+    for (int i = 0; i < SYNTHETIC_LINES; i++)
+    {
+        char* line = malloc(size + 1);
+        if (!line) return "Memory allocation failed";
+        int head = snprintf(line, size + 1, "line %04d ", i);
+        for (size_t j = head < 0 ? 0 : (size_t)head; j < size; j++) line[j] = fill[(j + (size_t)i) % (sizeof(fill) - 1)];
+        line[size] = '\0';
+        lg->lines[i] = line;
+        lg->lens[i] = size;
+        lg->num_lines++;
+    }
+    return NULL;
+}
+
+static void free_lines(loadgen_t* lg)
+{
+    for (size_t i = 0; lg->lines && i < lg->num_lines; i++) free(lg->lines[i]);
+    free(lg->lines);
+    free(lg->lens);
+}
+
+static int write_all(int fd, const char* data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, data, len);
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int connect_address(const char* address)
+{
+    int fd = -1;
+    if (strncmp(address, "unix:", 5) == 0)
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(address + 5) >= sizeof(addr.sun_path)) return -1;
+        strcpy(addr.sun_path, address + 5);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    else if (strncmp(address, "tcp:", 4) == 0)
+    {
+        unsigned long port;
+        if (parse_count(address + 4, &port) != 0 || port > 65535) return -1;
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    return fd;
+}
+
+// Start the analyzer with its stdout (and, without --connect, its stdin) on pipes
+static const char* start_analyzer(run_t* run)
+{
+    extern char** environ;
+    int out_pipe[2];
+    int in_pipe[2] = { -1, -1 };
+    if (pipe2(out_pipe, O_CLOEXEC) != 0) return "Failed to create pipe";
+    if (!run->lg->connect && pipe2(in_pipe, O_CLOEXEC) != 0)
+    {
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        return "Failed to create pipe";
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (in_pipe[0] >= 0) posix_spawn_file_actions_adddup2(&actions, in_pipe[0], 0);
+    else posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, out_pipe[1], 1);
+    int rc = posix_spawnp(&run->pid, run->lg->analyzer_argv[0], &actions, NULL, run->lg->analyzer_argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(out_pipe[1]);
+    if (in_pipe[0] >= 0) close(in_pipe[0]);
+    run->out_fd = out_pipe[0];
+    run->in_fd = in_pipe[1];
+    if (rc != 0)
+    {
+        close(run->out_fd);
+        if (run->in_fd >= 0) close(run->in_fd);
+        run->out_fd = -1;
+        run->in_fd = -1;
+        return "Failed to start the analyzer";
+    }
+    if (!run->lg->connect) return NULL;
+
+    // The server binds only after every plugin has loaded
+    for (int waited = 0; waited < LOADGEN_CONNECT_MS; waited++)
+    {
+        run->in_fd = connect_address(run->lg->connect);
+        if (run->in_fd >= 0) return NULL;
+        if (waitpid(run->pid, NULL, WNOHANG) == run->pid)
+        {
+            run->pid = -1;
+            break;
+        }
+        sleep_until(now_ns() + 1000000ULL);
+    }
+    return "Could not connect to the analyzer";
+}
+
+static void* sender_thread(void* arg)
+{
+    run_t* run = arg;
+    const loadgen_t* lg = run->lg;
+    char* batch = malloc(LOADGEN_BATCH);
+    if (!batch)
+    {
+        run->send_error = "Memory allocation failed";
+        return NULL;
+    }
+
+    unsigned long next = 0;
+    while (next < run->total)
+    {
+        uint64_t now = now_ns();
+        uint64_t due_at = intended_at(run, next);
+        if (due_at > now)
+        {
+            sleep_until(due_at);
+            continue;
+        }
+
+        // Everything already due goes out together; a late line keeps its intended time
+        size_t used = 0;
+        unsigned long first = next;
+        while (next < run->total && intended_at(run, next) <= now)
+        {
+            size_t k = next % lg->num_lines;
+            if (used + lg->lens[k] + 1 > LOADGEN_BATCH) break;
+            memcpy(batch + used, lg->lines[k], lg->lens[k]);
+            batch[used + lg->lens[k]] = '\n';
+            used += lg->lens[k] + 1;
+            run->sent_at[next++] = now;
+        }
+        if (write_all(run->in_fd, batch, used) != 0)
+        {
+            run->send_error = strerror(errno);
+            next = first;
+            break;
+        }
+    }
+    run->sent = next;
+    run->send_end = now_ns();
+    atomic_store(&run->send_done, 1);
+
+    // A pipe ends the pipeline; a connection only ends itself
+    if (!run->send_error && !lg->connect) write_all(run->in_fd, SENTINEL_END "\n", sizeof(SENTINEL_END));
+    if (lg->connect) shutdown(run->in_fd, SHUT_WR);
+    else
+    {
+        close(run->in_fd);
+        run->in_fd = -1;
+    }
+    free(batch);
+    return NULL;
+}
+
+// Match output lines to records by order and record their latency
+static void receive(run_t* run)
+{
+    const loadgen_t* lg = run->lg;
+    size_t prefix_len = strlen(lg->prefix);
+    size_t cap = 4 * LOADGEN_BATCH;
+    char* buf = malloc(cap);
+    if (!buf) return;
+    size_t used = 0;
+    uint64_t last_progress = now_ns();
+    int terminated = 0;
+    for (;;)
+    {
+        // Socket mode: stop the server once every record is back, or output has stalled
+        if (lg->connect && !terminated && run->pid > 0 && atomic_load(&run->send_done) &&
+            (run->received >= run->total || now_ns() - last_progress > LOADGEN_DRAIN_MS * 1000000ULL))
+        {
+            kill(run->pid, SIGTERM);
+            terminated = 1;
+        }
+        if (lg->connect && !terminated)
+        {
+            fd_set set;
+            FD_ZERO(&set);
+            FD_SET(run->out_fd, &set);
+            struct timeval tv = { 0, 100000 };
+            if (select(run->out_fd + 1, &set, NULL, NULL, &tv) <= 0) continue;
+        }
+
+        ssize_t n = read(run->out_fd, buf + used, cap - used);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        uint64_t now = now_ns();
+        last_progress = now;
+        used += (size_t)n;
+
+        size_t start = 0;
+        char* nl;
+        while ((nl = memchr(buf + start, '\n', used - start)) != NULL)
+        {
+            size_t len = (size_t)(nl - (buf + start));
+            if (len >= prefix_len && memcmp(buf + start, lg->prefix, prefix_len) == 0)
+            {
+                unsigned long i = run->received++;
+                if (i >= run->warmup_lines && i < run->total)
+                {
+                    uint64_t intended = intended_at(run, i);
+                    hist_record(&run->corrected, now > intended ? now - intended : 0);
+                    hist_record(&run->uncorrected, now > run->sent_at[i] ? now - run->sent_at[i] : 0);
+                }
+            }
+            start += len + 1;
+        }
+        memmove(buf, buf + start, used - start);
+        used -= start;
+        // A line longer than the buffer cannot be a record; drop what is held
+        if (used == cap) used = 0;
+    }
+    free(buf);
+}
+
+// One run at a fixed rate; returns 0 when every record came back
+static int run_rate(const loadgen_t* lg, unsigned long rate, run_t* run, const char** error)
+{
+    memset(run, 0, sizeof(*run));
+    run->lg = lg;
+    run->rate = rate;
+    run->pid = -1;
+    run->in_fd = -1;
+    run->out_fd = -1;
+    atomic_init(&run->send_done, 0);
+    run->warmup_lines = (unsigned long)(lg->warmup * (double)rate);
+    double total = (lg->warmup + lg->duration) * (double)rate;
+    if (total > (double)LOADGEN_MAX_LINES)
+    {
+        *error = "Rate times duration exceeds 50M lines";
+        return -1;
+    }
+    run->total = (unsigned long)total;
+    if (run->total <= run->warmup_lines)
+    {
+        *error = "Duration too short for this rate";
+        return -1;
+    }
+    run->sent_at = calloc(run->total, sizeof(uint64_t));
+    if (!run->sent_at)
+    {
+        *error = "Memory allocation failed";
+        return -1;
+    }
+
+    *error = start_analyzer(run);
+    if (*error)
+    {
+        if (run->pid > 0)
+        {
+            kill(run->pid, SIGKILL);
+            waitpid(run->pid, NULL, 0);
+        }
+        if (run->out_fd >= 0) close(run->out_fd);
+        free(run->sent_at);
+        return -1;
+    }
+
+    run->t0 = now_ns();
+    pthread_t sender;
+    if (pthread_create(&sender, NULL, sender_thread, run) != 0)
+    {
+        *error = "Failed to create sender thread";
+        kill(run->pid, SIGKILL);
+        close(run->in_fd);
+        close(run->out_fd);
+        waitpid(run->pid, NULL, 0);
+        free(run->sent_at);
+        return -1;
+    }
+    receive(run);
+    pthread_join(sender, NULL);
+    if (run->in_fd >= 0) close(run->in_fd);
+    close(run->out_fd);
+    int status = 0;
+    if (run->pid > 0) waitpid(run->pid, &status, 0);
+    free(run->sent_at);
+    run->sent_at = NULL;
+
+    *error = run->send_error;
+    if (!*error && WIFSIGNALED(status) && WTERMSIG(status) != SIGTERM) *error = "Analyzer was killed by a signal";
+    return !*error && run->received >= run->total ? 0 : -1;
+}
+
+static void print_run(const run_t* run, const char* error)
+{
+    double seconds = run->send_end > run->t0 ? (run->send_end - run->t0) / 1e9 : 0;
+    printf("Rate %lu lines/s: sent %lu of %lu (%.0f/s achieved), received %lu\n", run->rate, run->sent,
+           run->total, seconds > 0 ? run->sent / seconds : 0.0, run->received);
+    if (error) printf("  error: %s\n", error);
+    else if (run->received < run->total)
+    {
+        printf("  %lu records missing: the pipeline dropped records or did not print them with the prefix\n",
+               run->total - run->received);
+    }
+    if (run->corrected.total == 0) return;
+    print_histogram("from intended send:", &run->corrected);
+    print_histogram("from actual send:", &run->uncorrected);
+}
+
+static int sustainable(const loadgen_t* lg, unsigned long rate, run_t* run)
+{
+    const char* error = NULL;
+    int ok = run_rate(lg, rate, run, &error) == 0;
+    uint64_t p99 = hist_percentile(&run->corrected, 99);
+    ok = ok && p99 <= (uint64_t)(lg->slo_ms * 1e6);
+    char value[32];
+    format_ns(p99, value, sizeof(value));
+    printf("  %10lu lines/s  p99 %-10s %s%s%s\n", rate, value, ok ? "ok" : "too slow",
+           error ? ": " : "", error ? error : "");
+    fflush(stdout);
+    return ok;
+}
+
+static int run_sweep(const loadgen_t* lg)
+{
+    run_t* run = malloc(sizeof(*run));
+    if (!run) return 1;
+    printf("Sweeping for the highest rate with p99 within %.3g ms (%.3g s per step):\n", lg->slo_ms,
+           lg->warmup + lg->duration);
+
+    unsigned long pass = 0;
+    unsigned long fail = 0;
+    unsigned long rate = lg->rate;
+    for (;;)
+    {
+        if (!sustainable(lg, rate, run))
+        {
+            fail = rate;
+            break;
+        }
+        pass = rate;
+        if (rate >= lg->max_rate) break;
+        rate = rate > lg->max_rate / 2 ? lg->max_rate : rate * 2;
+    }
+    for (int step = 0; fail && pass && step < LOADGEN_BISECT && fail - pass > pass / 50; step++)
+    {
+        unsigned long mid = pass + (fail - pass) / 2;
+        if (sustainable(lg, mid, run)) pass = mid;
+        else fail = mid;
+    }
+
+    if (pass == 0) printf("No sustainable rate: %lu lines/s already misses the target\n", lg->rate);
+    else if (!fail) printf("Max sustainable rate: at least %lu lines/s (--max-rate reached)\n", pass);
+    else printf("Max sustainable rate: %lu lines/s\n", pass);
+    free(run);
+    return pass ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    loadgen_t lg;
+    memset(&lg, 0, sizeof(lg));
+    lg.rate = 10000;
+    lg.duration = 5;
+    lg.warmup = 1;
+    lg.prefix = "[logger] ";
+    lg.slo_ms = 10;
+    lg.max_rate = 10000000;
+    const char* input_path = NULL;
+    unsigned long line_size = 64;
+
+    int argi = 1;
+    while (argi < argc && strcmp(argv[argi], "--") != 0)
+    {
+        const char* opt = argv[argi];
+        const char* value = argi + 1 < argc ? argv[argi + 1] : NULL;
+        int bad = 0;
+        if (strcmp(opt, "--sweep") == 0)
+        {
+            lg.sweep = 1;
+            argi += 1;
+            continue;
+        }
+        if (!value) bad = 1;
+        else if (strcmp(opt, "--rate") == 0) bad = parse_count(value, &lg.rate);
+        else if (strcmp(opt, "--duration") == 0) bad = parse_seconds(value, &lg.duration, 0.001);
+        else if (strcmp(opt, "--warmup") == 0) bad = parse_seconds(value, &lg.warmup, 0);
+        else if (strcmp(opt, "--input") == 0) input_path = value;
+        else if (strcmp(opt, "--line-size") == 0) bad = parse_count(value, &line_size) || line_size > LOADGEN_LINE_MAX;
+        else if (strcmp(opt, "--connect") == 0) lg.connect = value;
+        else if (strcmp(opt, "--prefix") == 0) lg.prefix = value;
+        else if (strcmp(opt, "--slo") == 0) bad = parse_seconds(value, &lg.slo_ms, 0.001);
+        else if (strcmp(opt, "--max-rate") == 0) bad = parse_count(value, &lg.max_rate);
+        else bad = 1;
+        if (bad)
+        {
+            fprintf(stderr, "Error: Unknown, incomplete or invalid option '%s'\n", opt);
+            print_usage();
+            return 1;
+        }
+        argi += 2;
+    }
+    if (argi + 1 >= argc)
+    {
+        fprintf(stderr, "Error: Missing analyzer command after --\n");
+        print_usage();
+        return 1;
+    }
+    lg.analyzer_argv = argv + argi + 1;
+
+    const char* error = input_path ? load_input(&lg, input_path) : make_lines(&lg, line_size);
+    if (error)
+    {
+        fprintf(stderr, "Error loading input%s%s: %s\n", input_path ? " " : "", input_path ? input_path : "", error);
+        free_lines(&lg);
+        return 1;
+    }
+
+    // A dead analyzer surfaces as EPIPE from write
+    signal(SIGPIPE, SIG_IGN);
+
+    int rc;
+    if (lg.sweep) rc = run_sweep(&lg);
+    else
+    {
+        run_t* run = malloc(sizeof(*run));
+        if (!run)
+        {
+            free_lines(&lg);
+            return 1;
+        }
+        rc = run_rate(&lg, lg.rate, run, &error) == 0 ? 0 : 1;
+        print_run(run, error);
+        free(run);
+    }
+    free_lines(&lg);
+    return rc;
+}